@@ -0,0 +1,84 @@
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+using namespace std;
+
+
+arena::arena()
+{
+	current = 0;
+	used_in_chunk = 0;
+	live_bytes = 0;
+}
+
+
+arena::~arena()
+{
+	release();
+	for (char* chunk : chunks)
+		delete [] chunk;
+}
+
+
+size_t arena::chunk_bytes(size_t i)
+{
+	return (i >= 5) ? chunk_size : (first_chunk_size << i);
+}
+
+
+void* arena::allocate(size_t bytes, size_t alignment)
+{
+	live_bytes += bytes;
+	if (bytes > chunk_size)
+	{
+		oversized.push_back(new char[bytes]);		// too big for a chunk; gets its own block
+		return oversized.back();
+	}
+
+	size_t start = (used_in_chunk + alignment - 1) & ~(alignment - 1);
+	while ((current == chunks.size()) or (start + bytes > chunk_bytes(current)))
+	{
+		// Move on to the next chunk, reusing one kept from before the last release if there is one.
+		if (current < chunks.size())
+			current++;
+		if (current == chunks.size())
+			chunks.push_back(new char[chunk_bytes(current)]);
+		start = 0;
+	}
+	used_in_chunk = start + bytes;
+	return chunks[current] + start;
+}
+
+
+void arena::release()
+{
+	while (!finalizers.empty())
+	{
+		finalizers.back().destroy(finalizers.back().object);
+		finalizers.pop_back();
+	}
+	for (char* block : oversized)
+		delete [] block;
+	oversized.clear();
+	current = 0;
+	used_in_chunk = 0;
+	live_bytes = 0;
+}
+
+
+size_t arena::bytes_in_use()
+{
+	return live_bytes;
+}
+
+
+size_t arena::bytes_reserved()
+{
+	size_t total = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+		total += chunk_bytes(i);
+	return total;
+}
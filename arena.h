@@ -0,0 +1,66 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+using namespace std;
+
+class arena {
+private:
+	static const size_t first_chunk_size = 512;	// Chunks start small, since most scopes hold a handful of entries,
+	static const size_t chunk_size = 16384;		// and double up to this size.
+	static_assert(first_chunk_size << 5 == chunk_size, "chunk_bytes() doubles the chunk size five times");
+
+	struct finalizer {
+		void (*destroy)(void*);					// Runs the destructor of object.
+		void* object;
+	};
+
+	vector<char*> chunks;						// Chunk i holds chunk_bytes(i) bytes. chunks[current] is being carved up.
+	size_t current;								// Index of the chunk allocations are taken from.
+	size_t used_in_chunk;						// Bytes handed out from chunks[current].
+	vector<char*> oversized;					// Allocations bigger than a chunk, freed on release.
+	vector<finalizer> finalizers;				// Objects that need their destructor run on release, oldest first.
+	size_t live_bytes;							// Bytes handed out since the last release.
+
+	static size_t chunk_bytes(size_t i);
+
+	template <class T>
+	static void destroy(void* p) { static_cast<T*>(p)->~T(); }
+
+public:
+	arena();
+	~arena();
+
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	void* allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+	// Returns bytes of uninitialised memory. Nothing is freed until release() is called.
+
+	template <class T, class... Args>
+	T* make(Args&&... args)
+	// Constructs a T in the arena. Its destructor is run by release().
+	{
+		T* p = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!is_trivially_destructible<T>::value)
+			finalizers.push_back(finalizer{destroy<T>, p});
+		return p;
+	}
+
+	void release();
+	// Destroys every object made in the arena, newest first, and takes it back to empty. The chunks are
+	// kept for reuse, so an arena that is filled and released over and over stays the same size.
+
+	size_t bytes_in_use();
+	// Bytes handed out since the last release.
+
+	size_t bytes_reserved();
+	// Bytes held from the heap.
+};
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "ast.h"
+#include "arena.h"
+#include "symbol.h"
+#include "lille_type.h"
+#include "lille_kind.h"
+#include "name_table.h"
+
+using namespace std;
+
+
+ast::ast()
+{
+	next_node = 1;					// node 0 is no_node
+	string_starts.push_back(0);		// start of the first string
+}
+
+
+ast::node_id ast::add(node_kind kind, uint32_t offset, lille_type type, uint32_t value, uint16_t op)
+{
+	if ((next_node & (block_nodes - 1)) == 0 or blocks.empty())
+		blocks.push_back(static_cast<node*>(nodes_arena.allocate(block_nodes * sizeof(node), alignof(node))));
+	node_id n = next_node++;
+	node& made = (*this)[n];
+	made.kind = kind;
+	made.type = type.get_type();
+	made.op = op;
+	made.offset = offset;
+	made.value = value;
+	made.first_child = no_node;
+	made.last_child = no_node;
+	made.next_sibling = no_node;
+	return n;
+}
+
+
+void ast::add_child(node_id parent, node_id child)
+{
+	if ((parent == no_node) or (child == no_node))
+		return;
+	node& p = (*this)[parent];
+	if (p.first_child == no_node)
+		p.first_child = child;
+	else
+		(*this)[p.last_child].next_sibling = child;
+	p.last_child = child;
+}
+
+
+uint32_t ast::add_string(const string& s)
+{
+	string_chars.insert(string_chars.end(), s.begin(), s.end());
+	string_starts.push_back(string_chars.size());
+	return string_starts.size() - 2;
+}
+
+
+string ast::string_at(uint32_t i)
+{
+	return string(string_chars.data() + string_starts[i], string_starts[i + 1] - string_starts[i]);
+}
+
+
+size_t ast::node_count()
+{
+	return next_node - 1;
+}
+
+
+void ast::release()
+{
+	nodes_arena.release();
+	blocks.clear();
+	next_node = 1;
+	string_chars.clear();
+	string_starts.resize(1);
+}
+
+
+void ast::print(node_id n, ostream& out, int depth)
+{
+	static const char* const kind_names[] = {
+		"PROGRAM", "BLOCK", "VARIABLE", "PROCEDURE", "FUNCTION", "PARAM", "STATEMENTS", "ASSIGN", "CALL", "IF",
+		"LOOP", "FOR", "WHILE", "EXIT", "RETURN", "READ", "WRITE", "WRITELN", "NULL", "OPERATOR",
+		"IDENTIFIER", "LITERAL"
+	};
+
+	node& nd = (*this)[n];
+	lille_type type = lille_type(lille_type::lille_ty(nd.type));
+	out << string(2 * depth, ' ') << kind_names[nd.kind];
+	switch (nd.kind)
+	{
+		case program_node:
+		case procedure_node:
+		case function_node:
+		case call_node:
+		case for_node:
+		case identifier_node:
+			if (nd.value != name_table::no_name)		// a declaration whose name is missing has none
+				out << " " << name_table::current()->name(nd.value);
+			break;
+		case param_node:
+			out << " " << name_table::current()->name(nd.value) << " " << lille_kind(lille_kind::lille_knd(nd.op)).to_string();
+			break;
+		case variable_node:
+			out << " " << lille_kind(lille_kind::lille_knd(nd.op)).to_string();
+			break;
+		case operator_node:
+			out << " " << symbol(symbol::symbol_type(nd.op)).symtostr();
+			break;
+		case literal_node:
+			if (type.is_type(lille_type::type_integer))
+				out << " " << int(nd.value);
+			else if (type.is_type(lille_type::type_real))
+			{
+				float f;
+				memcpy(&f, &nd.value, sizeof(f));
+				out << " " << f;
+			}
+			else if (type.is_type(lille_type::type_string))
+				out << " \"" << string_at(nd.value) << "\"";
+			else
+				out << (nd.value ? " TRUE" : " FALSE");
+			break;
+		default:
+			break;
+	}
+	if (!type.is_type(lille_type::type_unknown))
+		out << " : " << type.to_string();
+	out << endl;
+
+	for (node_id child = nd.first_child; child != no_node; child = (*this)[child].next_sibling)
+		print(child, out, depth + 1);
+}
@@ -0,0 +1,114 @@
+#ifndef AST_H_
+#define AST_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "arena.h"
+#include "lille_type.h"
+
+using namespace std;
+
+class ast {
+// The syntax tree of a compilation, built by the parser. Nodes are carved out of an arena in blocks and
+// refer to each other by 32-bit index rather than by pointer; the children of a node are a list threaded
+// through next_sibling. Identifiers are held as their name_table IDs. Nothing is freed node by node: the
+// whole tree goes at once, by release() or with the tree.
+// An expression is an operator, identifier, literal or call node, typed by the parser as it is built.
+public:
+	typedef uint32_t node_id;				// Index of a node in the tree.
+	static const node_id no_node = 0;		// Index 0 is never handed out, so it stands for a missing node.
+
+	enum node_kind : uint8_t {
+		program_node,			// value: name ID. children: the block.
+		block_node,				// children: the declarations, then the statement list.
+		variable_node,			// Declaration of variables or a constant. type: their type. op: their lille_kind.
+								// children: an identifier for each name, then the value of a constant.
+		procedure_node,			// value: name ID. children: the parameters, then the block.
+		function_node,			// As procedure_node. type: the return type.
+		param_node,				// value: name ID. type: its type. op: value_param or ref_param.
+		statement_list_node,	// children: the statements.
+		assign_node,			// children: the identifier assigned to, then the expression.
+		call_node,				// value: name ID of the procedure or function. type: the return type of a function.
+								// children: the argument expressions.
+		if_node,				// children: a condition and a statement list for IF and for each ELSIF, then the
+								// ELSE statement list, if there is one. A condition is an expression.
+		loop_node,				// children: the statement list.
+		for_node,				// value: name ID of the loop variable. op: 1 for REVERSE, else 0. children: the
+								// lower and upper bound expressions, then the loop.
+		while_node,				// children: the condition, then the loop.
+		exit_node,				// children: the condition of EXIT WHEN, if there is one.
+		return_node,			// children: the value returned, if there is one.
+		read_node,				// children: an identifier for each variable read.
+		write_node,				// children: the expressions written.
+		writeln_node,			// As write_node.
+		null_node,
+		operator_node,			// op: the symbol_type of the operator. type: the type of its result, or unknown if
+								// an operand was wrong. children: the operand of unary +, -, NOT and ODD, the
+								// two operands of a binary operator, or the value and bounds of IN.
+		identifier_node,		// value: name ID. type: the type it was declared with, or unknown.
+		literal_node			// type: integer, real, string or boolean. value: the integer, the bits of the real,
+								// the index of the string given by string_at(), or 1 for TRUE and 0 for FALSE.
+	};
+
+	struct node {
+		node_kind kind;
+		uint8_t type;			// lille_type::lille_ty of the node.
+		uint16_t op;			// Meaning depends on kind, as above.
+		uint32_t offset;		// Byte offset in the source of the first symbol of the node.
+		uint32_t value;			// Meaning depends on kind, as above.
+		node_id first_child;	// no_node if there are no children.
+		node_id last_child;		// Kept so children can be appended in constant time.
+		node_id next_sibling;	// no_node for the last child.
+	};
+
+private:
+	static const int block_shift = 9;
+	static const size_t block_nodes = size_t(1) << block_shift;	// Nodes carved out of the arena at a time.
+	static_assert(block_nodes * sizeof(node) <= 16384, "a block of nodes must fit in an arena chunk");
+
+	arena nodes_arena;					// Holds the blocks of nodes.
+	vector<node*> blocks;				// Node n is blocks[n >> block_shift][n % block_nodes].
+	node_id next_node;					// Index of the next node to be handed out.
+
+	vector<char> string_chars;			// Text of every string literal, stored back to back.
+	vector<uint32_t> string_starts;		// string_starts[i] is where string i begins in string_chars. It ends
+										// where string i + 1 begins.
+
+public:
+	ast();
+	// Creates an empty tree.
+
+	node_id add(node_kind kind, uint32_t offset, lille_type type = lille_type(), uint32_t value = 0, uint16_t op = 0);
+	// Returns a new node with no children.
+
+	void add_child(node_id parent, node_id child);
+	// Makes child the last child of parent. Does nothing if either is no_node.
+
+	node& operator[](node_id n)
+	// The node with index n.
+	{
+		return blocks[n >> block_shift][n & (block_nodes - 1)];
+	}
+
+	uint32_t add_string(const string& s);
+	// Keeps the text of a string literal and returns its index.
+
+	string string_at(uint32_t i);
+	// Returns the string literal with index i.
+
+	size_t node_count();
+	// Number of nodes made since the tree was last released.
+
+	void release();
+	// Frees every node and string at once, leaving the tree empty. Nodes need no destructor, so the cost does
+	// not depend on the size of the tree; the memory is kept for the next tree built.
+
+	void print(node_id n, ostream& out, int depth = 0);
+	// Writes node n and everything below it to out, one node per line, indented by depth.
+};
+
+#endif /* AST_H_ */
@@ -0,0 +1,429 @@
+// End to end benchmark of the compiler, with a regression check against a stored baseline.
+//
+// Compiles a fixed set of generated Lille programs through the whole pipeline: scanner, parser, id_table and
+// error handler, as the compiler does. Each compilation runs in a child process of its own, so that it has a
+// peak RSS of its own, and records:
+//        wall_us        elapsed time of the compilation
+//        maxrss_kb      peak resident set size of the child
+//        allocations    calls to operator new during the compilation, and alloc_bytes, the bytes they asked for
+//        instructions, cycles, cache_misses and branch_misses, from perf_event_open, user space only, where
+//                       the kernel allows it; they are left out otherwise
+// The median of the runs of each program is reported, and compared with the baseline if there is one.
+//
+// Usage
+//        compile_bench [-reps=n] [-pretokenize] [-baseline=file] [-save-baseline] [-threshold=pct]
+//                      [-threshold=metric:pct] [-json]
+//
+// -save-baseline writes the results to the baseline file instead of comparing with it. A metric more than its
+// threshold percent above the baseline is a regression: each is listed, and the exit status is 1. The default
+// threshold is 10%; -threshold=metric:pct sets it for one metric, such as -threshold=wall_us:25.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <new>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "lille_exception.h"
+#include "source_buffer.h"
+#include "error_handler.h"
+#include "name_table.h"
+#include "id_table.h"
+#include "scanner.h"
+#include "parser.h"
+#include "lille_corpus.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Every allocation made through operator new is counted while counting is set.
+static bool counting = false;
+static unsigned long long allocation_count = 0;
+static unsigned long long allocation_bytes = 0;
+
+void* operator new(size_t n)
+{
+	if (counting)
+	{
+		allocation_count++;
+		allocation_bytes += n;
+	}
+	void* p = malloc((n == 0) ? 1 : n);
+	if (p == NULL)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t n)
+{
+	return operator new(n);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+
+struct program {
+	string name;
+	corpus_shape shape;
+	string filename;
+};
+
+static const char* const metric_names[] = { "wall_us", "maxrss_kb", "allocations", "alloc_bytes", "instructions",
+		"cycles", "cache_misses", "branch_misses" };
+static const int metric_count = sizeof(metric_names) / sizeof(metric_names[0]);
+static const int first_counter = 4;		// metrics from first_counter on come from perf_event_open
+static const long long unavailable = -1;
+
+struct run_result {						// Sent from the child that compiled a program to the parent.
+	long long metric[metric_count];
+	int errors;
+	bool compiled;
+};
+
+
+vector<program> fixed_corpus()
+// The same programs every time, so results can be compared from one build to the next.
+{
+	vector<program> programs(4);
+	programs[0].name = "small";
+	programs[0].shape.bytes = 64 << 10;
+	programs[1].name = "medium";
+	programs[1].shape.bytes = 1 << 20;
+	programs[1].shape.seed = 2;
+	programs[2].name = "large";
+	programs[2].shape.bytes = 8 << 20;
+	programs[2].shape.seed = 3;
+	programs[3].name = "nested";
+	programs[3].shape.bytes = 1 << 20;
+	programs[3].shape.nesting = 12;
+	programs[3].shape.seed = 4;
+	for (program& p : programs)
+		p.filename = "compile_bench_" + p.name + ".l";
+	return programs;
+}
+
+
+#ifdef __linux__
+static int open_counter(unsigned long long config)
+// A hardware counter for this process, counting user space only, stopped. Returns -1 if it is not available.
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+
+run_result compile(const program& p, bool pretokenize)
+// Compile p, as the compiler does. Runs in the child process.
+{
+	run_result r;
+	for (int m = 0; m < metric_count; m++)
+		r.metric[m] = unavailable;
+
+	int counter[metric_count - first_counter];
+	for (int c = 0; c < metric_count - first_counter; c++)
+		counter[c] = -1;
+#ifdef __linux__
+	static const unsigned long long configs[] = { PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+	for (int c = 0; c < metric_count - first_counter; c++)
+		counter[c] = open_counter(configs[c]);
+	for (int c = 0; c < metric_count - first_counter; c++)
+		if (counter[c] >= 0)
+			ioctl(counter[c], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	counting = true;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+
+	source_buffer* source = new source_buffer(p.filename);
+	error_handler* err = new error_handler(source);
+	name_table* names = new name_table();
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(source, names, table, err);
+	parser* parse = new parser(scan, table, err);
+	r.compiled = true;
+	try
+	{
+		if (pretokenize)
+			scan->pretokenize();
+		scan->get_token();
+		while (scan->have(symbol::program_sym))
+			parse->PROG();
+		scan->must_be(symbol::end_of_program);
+	}
+	catch (lille_exception& e)
+	{
+		r.compiled = false;
+	}
+	r.errors = err->error_count();
+
+	r.metric[0] = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+	counting = false;
+#ifdef __linux__
+	for (int c = 0; c < metric_count - first_counter; c++)
+	{
+		long long value;
+		if ((counter[c] >= 0) and (ioctl(counter[c], PERF_EVENT_IOC_DISABLE, 0) == 0)
+				and (read(counter[c], &value, sizeof(value)) == sizeof(value)))
+			r.metric[first_counter + c] = value;
+	}
+#endif
+	r.metric[2] = allocation_count;
+	r.metric[3] = allocation_bytes;
+	return r;
+}
+
+
+bool run(const program& p, bool pretokenize, run_result& r)
+// Compile p in a child process and collect its results, adding its peak RSS.
+{
+	int result_pipe[2];
+	if (pipe(result_pipe) != 0)
+		return false;
+	cout.flush();
+	pid_t child = fork();
+	if (child == 0)
+	{
+		close(result_pipe[0]);
+		run_result mine = compile(p, pretokenize);
+		bool sent = (write(result_pipe[1], &mine, sizeof(mine)) == sizeof(mine));
+		_exit(sent ? 0 : 1);
+	}
+	close(result_pipe[1]);
+	bool received = (child > 0) and (read(result_pipe[0], &r, sizeof(r)) == sizeof(r));
+	close(result_pipe[0]);
+
+	int status = 0;
+	struct rusage usage;
+	if ((child > 0) and (wait4(child, &status, 0, &usage) == child))
+		r.metric[1] = usage.ru_maxrss;
+	return received and WIFEXITED(status) and (WEXITSTATUS(status) == 0);
+}
+
+
+string json_line(const string& name, size_t bytes, const long long* metric)
+// One program's results, as a line of the baseline file.
+{
+	ostringstream out;
+	out << "{\"corpus\":\"" << name << "\",\"bytes\":" << bytes;
+	for (int m = 0; m < metric_count; m++)
+	{
+		out << ",\"" << metric_names[m] << "\":";
+		if (metric[m] == unavailable)
+			out << "null";
+		else
+			out << metric[m];
+	}
+	out << "}";
+	return out.str();
+}
+
+
+map<string, map<string, long long>> read_baseline(const string& filename)
+// The metrics of each program in a baseline written by -save-baseline: one program per line. Null metrics
+// are left out.
+{
+	map<string, map<string, long long>> baseline;
+	ifstream in(filename);
+	string line;
+	while (getline(in, line))
+	{
+		size_t at = line.find("\"corpus\":\"");
+		if (at == string::npos)
+			continue;
+		at += 10;
+		string name = line.substr(at, line.find('"', at) - at);
+		for (int m = 0; m < metric_count; m++)
+		{
+			string key = string("\"") + metric_names[m] + "\":";
+			size_t k = line.find(key);
+			if ((k != string::npos) and (line.compare(k + key.size(), 4, "null") != 0))
+				baseline[name][metric_names[m]] = atoll(line.c_str() + k + key.size());
+		}
+	}
+	return baseline;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int reps = 3;
+	bool pretokenize = false;
+	bool save = false;
+	bool json = false;
+	string baseline_filename = "bench/compile_baseline.json";
+	double default_threshold = 10.0;
+	map<string, double> thresholds;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		size_t colon = arg.find(':');
+		if (arg.rfind("-reps=", 0) == 0)
+			reps = max(1, atoi(arg.c_str() + 6));
+		else if (arg == "-pretokenize")
+			pretokenize = true;
+		else if (arg.rfind("-baseline=", 0) == 0)
+			baseline_filename = arg.substr(10);
+		else if (arg == "-save-baseline")
+			save = true;
+		else if (arg == "-json")
+			json = true;
+		else if ((arg.rfind("-threshold=", 0) == 0) and (colon == string::npos))
+			default_threshold = atof(arg.c_str() + 11);
+		else if (arg.rfind("-threshold=", 0) == 0)
+			thresholds[arg.substr(11, colon - 11)] = atof(arg.c_str() + colon + 1);
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [-reps=n] [-pretokenize] [-baseline=file] [-save-baseline]"
+				 << " [-threshold=pct] [-threshold=metric:pct] [-json]" << endl;
+			return (arg == "-h") ? 0 : 1;
+		}
+	}
+
+	vector<program> programs = fixed_corpus();
+	vector<size_t> sizes;
+	for (program& p : programs)
+	{
+		string text = lille_corpus(p.shape);
+		ofstream(p.filename, ios::binary) << text;
+		sizes.push_back(text.size());
+	}
+
+	if (!json)
+	{
+		cout << setw(8) << "corpus";
+		for (int m = 0; m < metric_count; m++)
+			cout << setw(15) << metric_names[m];
+		cout << endl;
+	}
+
+	bool failed = false;
+	vector<string> lines;
+	vector<vector<long long>> results;
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		vector<vector<long long>> samples(metric_count);
+		for (int r = 0; r < reps; r++)
+		{
+			run_result result;
+			if (!run(programs[i], pretokenize, result) or !result.compiled or (result.errors != 0))
+			{
+				cerr << programs[i].name << ": the compilation failed or found errors." << endl;
+				failed = true;
+				break;
+			}
+			for (int m = 0; m < metric_count; m++)
+				samples[m].push_back(result.metric[m]);
+		}
+
+		vector<long long> median(metric_count, unavailable);
+		for (int m = 0; m < metric_count; m++)
+			if (!samples[m].empty())
+			{
+				sort(samples[m].begin(), samples[m].end());
+				median[m] = samples[m][samples[m].size() / 2];
+			}
+		results.push_back(median);
+		lines.push_back(json_line(programs[i].name, sizes[i], median.data()));
+
+		if (json)
+			cout << lines.back() << endl;
+		else
+		{
+			cout << setw(8) << programs[i].name;
+			for (int m = 0; m < metric_count; m++)
+				cout << setw(15) << ((median[m] == unavailable) ? string("n/a") : to_string(median[m]));
+			cout << endl;
+		}
+	}
+	for (program& p : programs)
+		remove(p.filename.c_str());
+	if (failed)
+		return 1;
+
+	if (save)
+	{
+		ofstream out(baseline_filename);
+		out << "{\"corpora\":[" << endl;
+		for (size_t i = 0; i < lines.size(); i++)
+			out << lines[i] << ((i + 1 < lines.size()) ? "," : "") << endl;
+		out << "]}" << endl;
+		cerr << "Baseline saved to " << baseline_filename << "." << endl;
+		return 0;
+	}
+
+	if (!ifstream(baseline_filename))
+	{
+		cerr << "No baseline in " << baseline_filename << "; run with -save-baseline to record one." << endl;
+		return 0;
+	}
+	map<string, map<string, long long>> baseline = read_baseline(baseline_filename);
+	int regressions = 0;
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		for (int m = 0; m < metric_count; m++)
+		{
+			map<string, long long>& before = baseline[programs[i].name];
+			if ((results[i][m] == unavailable) or (before.count(metric_names[m]) == 0) or (before[metric_names[m]] <= 0))
+				continue;
+			double threshold = thresholds.count(metric_names[m]) ? thresholds[metric_names[m]] : default_threshold;
+			double change = 100.0 * (results[i][m] - before[metric_names[m]]) / before[metric_names[m]];
+			if (change > threshold)
+			{
+				if (regressions++ == 0)
+					cerr << "Regressions against " << baseline_filename << ":" << endl;
+				cerr << "    " << setw(8) << programs[i].name << setw(15) << metric_names[m] << setw(14)
+					 << before[metric_names[m]] << " -> " << setw(14) << results[i][m] << "  +" << fixed
+					 << setprecision(1) << change << "% (threshold " << threshold << "%)" << endl;
+			}
+		}
+	}
+	if (regressions > 0)
+	{
+		cerr << regressions << " metrics regressed by more than their threshold." << endl;
+		return 1;
+	}
+	cerr << "No regressions against " << baseline_filename << "." << endl;
+	return 0;
+}
@@ -0,0 +1,44 @@
+// Writes a synthetic Lille program, as used by lexer_bench, so it can be compiled or benchmarked by hand.
+//
+// Usage
+//        corpus_gen [flags] [filename]
+//
+// The program goes to standard output if no filename is given.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "lille_corpus.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+	corpus_shape shape;
+	string filename = "";
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if ((arg[0] != '-') and filename.empty())
+			filename = arg;
+		else if (!parse_corpus_shape(arg, shape))
+		{
+			cerr << "Usage: " << argv[0] << " [flags] [filename]" << endl
+				 << "    Writes a valid Lille program to filename, or to standard output. Valid flags are:" << endl
+				 << corpus_shape_usage();
+			return (arg == "-h") ? 0 : 1;
+		}
+	}
+
+	string text = lille_corpus(shape);
+	if (filename.empty())
+		cout << text;
+	else
+	{
+		ofstream out(filename, ios::binary);
+		out << text;
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+// Throughput benchmark for the scanner.
+//
+// Generates synthetic Lille corpora of different make-up, then times scanner::get_token() over each of them
+// from the first token to end_of_program, reporting tokens and megabytes per second. Each corpus is scanned
+// warmup times untimed, then reps times timed; the best and median times are reported.
+//
+// Usage
+//        lexer_bench [-reps=n] [-warmup=n] [-json] [corpus flags]
+//
+// With no corpus flags, every standard corpus is run at 2 MB. Any corpus flag, as taken by corpus_gen,
+// runs a single corpus of that shape instead. -json writes one JSON object per corpus, one per line.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+
+#include "lille_exception.h"
+#include "source_buffer.h"
+#include "error_handler.h"
+#include "name_table.h"
+#include "id_table.h"
+#include "scanner.h"
+#include "simd_scan.h"
+#include "lille_corpus.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string bench_source_file_name = "lexer_bench.l";
+
+struct corpus {
+	string name;
+	corpus_shape shape;
+};
+
+
+vector<corpus> standard_corpora()
+{
+	const size_t bytes = 2 << 20;
+	vector<corpus> corpora(5);
+	corpora[0].name = "balanced";
+	corpora[1].name = "identifiers";
+	corpora[1].shape.identifier_density = 0.95;
+	corpora[2].name = "literals";
+	corpora[2].shape.identifier_density = 0.05;
+	corpora[2].shape.integer_weight = 2;
+	corpora[2].shape.real_weight = 4;
+	corpora[2].shape.string_weight = 2;
+	corpora[3].name = "comments";
+	corpora[3].shape.comment_ratio = 0.6;
+	corpora[4].name = "nested";
+	corpora[4].shape.nesting = 12;
+	for (corpus& c : corpora)
+		c.shape.bytes = bytes;
+	return corpora;
+}
+
+
+long long scan_all(int& tokens, int& errors)
+// Scan the corpus file to the end. Returns the time in microseconds.
+{
+	source_buffer* source = new source_buffer(bench_source_file_name);
+	error_handler* err = new error_handler(source);
+	name_table* names = new name_table();
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(source, names, table, err);
+
+	tokens = 0;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	do
+	{
+		scan->get_token();
+		tokens++;
+	} while (!scan->have(symbol::end_of_program));
+	long long micros = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+	errors = err->error_count();
+	delete scan;
+	delete table;
+	delete err;
+	delete names;
+	delete source;
+	return micros;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int reps = 5;
+	int warmup = 1;
+	bool json = false;
+	corpus custom = { "custom", corpus_shape() };
+	bool shaped = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.rfind("-reps=", 0) == 0)
+			reps = max(1, atoi(arg.c_str() + 6));
+		else if (arg.rfind("-warmup=", 0) == 0)
+			warmup = max(0, atoi(arg.c_str() + 8));
+		else if (arg == "-json")
+			json = true;
+		else if (parse_corpus_shape(arg, custom.shape))
+			shaped = true;
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [-reps=n] [-warmup=n] [-json] [corpus flags]" << endl
+				 << "    Corpus flags are:" << endl << corpus_shape_usage();
+			return (arg == "-h") ? 0 : 1;
+		}
+	}
+	vector<corpus> corpora = shaped ? vector<corpus>(1, custom) : standard_corpora();
+
+	string level = simd_scan::level_name(simd_scan::active_level());
+	if (!json)
+		cout << setw(12) << "corpus" << setw(10) << "bytes" << setw(10) << "tokens" << setw(11) << "best us"
+			 << setw(11) << "median us" << setw(10) << "Mtok/s" << setw(9) << "MB/s" << "  (" << level << ")" << endl;
+
+	bool clean = true;
+	for (corpus& c : corpora)
+	{
+		string text = lille_corpus(c.shape);
+		ofstream(bench_source_file_name, ios::binary) << text;
+
+		int tokens = 0;
+		int errors = 0;
+		vector<long long> times;
+		for (int r = 0; r < warmup + reps; r++)
+		{
+			long long micros = scan_all(tokens, errors);
+			if (r >= warmup)
+				times.push_back(max(micros, 1LL));
+		}
+		sort(times.begin(), times.end());
+		long long best = times.front();
+		long long median = times[times.size() / 2];
+		double tokens_per_s = tokens * 1e6 / best;
+		double mb_per_s = text.size() / (1024.0 * 1024.0) * 1e6 / best;
+		clean = clean and (errors == 0);
+
+		if (json)
+			cout << "{\"corpus\":\"" << c.name << "\",\"bytes\":" << text.size() << ",\"tokens\":" << tokens
+				 << ",\"reps\":" << reps << ",\"warmup\":" << warmup << ",\"best_us\":" << best
+				 << ",\"median_us\":" << median << ",\"tokens_per_s\":" << fixed << setprecision(0) << tokens_per_s
+				 << ",\"mb_per_s\":" << setprecision(2) << mb_per_s << ",\"simd\":\"" << level
+				 << "\",\"errors\":" << errors << "}" << endl;
+		else
+			cout << setw(12) << c.name << setw(10) << text.size() << setw(10) << tokens << setw(11) << best
+				 << setw(11) << median << setw(10) << fixed << setprecision(2) << tokens_per_s / 1e6
+				 << setw(9) << mb_per_s << ((errors == 0) ? "" : "  " + to_string(errors) + " errors") << endl;
+	}
+	remove(bench_source_file_name.c_str());
+	return clean ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+// Generator of synthetic Lille programs for the benchmarks.
+//
+// Statements are picked so that every program compiles without errors: each assignment keeps to one type,
+// conditions compare a variable with a literal, procedures only read their own value parameter, and nothing
+// is called. The lexer sees realistic text, and the parser and id_table can be timed on the same corpora.
+
+#include <string>
+#include <random>
+#include <cstdlib>
+
+#include "lille_corpus.h"
+
+using namespace std;
+
+static const char* const words[] = { "count", "total", "index", "limit", "offset", "step", "width", "height",
+		"sum", "delta", "item", "score", "balance", "position", "reading", "weight" };
+static const int word_count = sizeof(words) / sizeof(words[0]);
+static const int names_per_type = 12;		// Global variables declared of each type.
+
+
+class corpus_writer {
+private:
+	const corpus_shape& shape;
+	mt19937 gen;
+	string text;
+	int procedures;						// Procedures written so far, to give each a name of its own.
+	string parameter;					// Value parameter of the procedure being written, or "" in the main body.
+
+	double chance() { return uniform_real_distribution<double>(0.0, 1.0)(gen); }
+	int pick(int n) { return uniform_int_distribution<int>(0, n - 1)(gen); }
+
+	string variable(char type)
+	// One of the global variables of the given type: i, r, s or b.
+	{
+		int k = pick(names_per_type);
+		return string(words[(k * 5 + type) % word_count]) + "_" + type + to_string(k);
+	}
+
+	string integer_literal()
+	{
+		return to_string((chance() < 0.7) ? pick(100) : pick(1000000));
+	}
+
+	string real_literal()
+	{
+		switch (pick(4))
+		{
+		case 0:		return to_string(pick(1000)) + "." + to_string(pick(100));
+		case 1:		return "0." + to_string(pick(100000));
+		case 2:		return to_string(pick(10)) + "." + to_string(pick(1000)) + "e" + to_string(pick(6));
+		default:	return to_string(pick(100)) + "." + to_string(pick(10)) + "E-" + to_string(1 + pick(5));
+		}
+	}
+
+	string string_literal()
+	{
+		string s = "\"";
+		int n = 1 + pick(5);
+		for (int i = 0; i < n; i++)
+			s += string((i > 0) ? " " : "") + words[pick(word_count)];
+		if (chance() < 0.1)
+			s += " \"\"quoted\"\"";
+		return s + "\"";
+	}
+
+	string integer_operand()
+	{
+		if (chance() < shape.identifier_density)
+			return (!parameter.empty() and (chance() < 0.25)) ? parameter : variable('i');
+		return integer_literal();
+	}
+
+	string real_operand()
+	{
+		return (chance() < shape.identifier_density) ? variable('r') : real_literal();
+	}
+
+	void line(int indent, const string& s)
+	// Write one line, preceded by a comment line often enough to give shape.comment_ratio.
+	{
+		double ratio = min(shape.comment_ratio, 0.95);
+		for (double comments = ratio / (1.0 - ratio); chance() < comments; comments -= 1.0)
+			text += string(indent * 4, ' ') + "-- " + words[pick(word_count)] + " is kept up to date here\n";
+		text += string(indent * 4, ' ') + s + "\n";
+	}
+
+	void assignment(int indent)
+	// An assignment whose type is chosen by the literal weights, so literals come in the mix asked for.
+	{
+		int weights = shape.integer_weight + shape.real_weight + shape.string_weight + shape.boolean_weight;
+		int w = pick(max(weights, 1));
+		static const char* const integer_ops[] = { " + ", " - ", " * " };
+		if ((w -= shape.integer_weight) < 0)
+		{
+			string s = variable('i') + " := " + integer_operand();
+			for (int n = pick(3); n > 0; n--)
+				s += integer_ops[pick(3)] + integer_operand();
+			line(indent, s + ";");
+		}
+		else if ((w -= shape.real_weight) < 0)
+		{
+			string s = variable('r') + " := " + real_operand();
+			for (int n = pick(3); n > 0; n--)
+				s += integer_ops[pick(3)] + real_operand();
+			line(indent, s + ";");
+		}
+		else if ((w -= shape.string_weight) < 0)
+			line(indent, variable('s') + " := " + ((chance() < shape.identifier_density) ? variable('s') : string_literal()) + ";");
+		else if (chance() < shape.identifier_density)
+			line(indent, variable('b') + " := " + variable('b') + ";");
+		else
+			line(indent, variable('b') + " := " + ((pick(2) == 0) ? "true" : "false") + ";");
+	}
+
+	void statements(int indent, int depth, int n)
+	// N statements; up to depth of them nest inside one another.
+	{
+		for (int i = 0; i < n; i++)
+		{
+			double c = chance();
+			if ((depth > 0) and (c < 0.1))
+			{
+				line(indent, "if " + variable('i') + " > " + integer_literal() + " then");
+				statements(indent + 1, depth - 1, 2 + pick(3));
+				if (chance() < 0.5)
+				{
+					line(indent, "else");
+					statements(indent + 1, depth - 1, 1 + pick(3));
+				}
+				line(indent, "end if;");
+			}
+			else if ((depth > 0) and (c < 0.15))
+			{
+				string b = variable('b');
+				line(indent, "while " + b + " loop");
+				statements(indent + 1, depth - 1, 1 + pick(3));
+				line(indent + 1, b + " := false;");
+				line(indent, "end loop;");
+			}
+			else
+				assignment(indent);
+		}
+	}
+
+	void procedure(int indent, int depth)
+	// A procedure with procedures nested depth - 1 deeper inside it.
+	{
+		string name = "proc_" + to_string(++procedures);
+		string param = "n_" + to_string(procedures);
+		line(indent, "procedure " + name + "(" + param + " : value integer) is");
+		if (depth > 1)
+			procedure(indent + 1, depth - 1);
+		line(indent, "begin");
+		parameter = param;
+		statements(indent + 1, shape.nesting, 6 + pick(10));
+		parameter = "";
+		line(indent, "end " + name + ";");
+	}
+
+public:
+	corpus_writer(const corpus_shape& s) : shape(s), gen(s.seed)
+	{
+		procedures = 0;
+	}
+
+	string write()
+	{
+		text.reserve(shape.bytes + 4096);
+		text += "program corpus is\n";
+		for (char type : { 'i', 'r', 's', 'b' })
+		{
+			static const char* const type_names[] = { "integer", "real", "string", "boolean" };
+			string type_name = type_names[string("irsb").find(type)];
+			for (int k = 0; k < names_per_type; k++)
+				line(1, string(words[(k * 5 + type) % word_count]) + "_" + type + to_string(k) + " : " + type_name + ";");
+		}
+		do
+			procedure(1, max(shape.nesting, 1));
+		while (text.size() < shape.bytes);
+		text += "begin\n";
+		statements(1, shape.nesting, 10);
+		text += "end corpus;\n";
+		return text;
+	}
+};
+
+
+string lille_corpus(const corpus_shape& shape)
+{
+	return corpus_writer(shape).write();
+}
+
+
+bool parse_corpus_shape(const string& flag, corpus_shape& shape)
+{
+	size_t equals = flag.find('=');
+	if (equals == string::npos)
+		return false;
+	string name = flag.substr(0, equals);
+	const char* value = flag.c_str() + equals + 1;
+
+	if (name == "-bytes")
+		shape.bytes = strtoull(value, NULL, 10);
+	else if (name == "-identifiers")
+		shape.identifier_density = atof(value);
+	else if (name == "-literals")
+	{
+		char* p = (char*) value;
+		int* weights[] = { &shape.integer_weight, &shape.real_weight, &shape.string_weight, &shape.boolean_weight };
+		for (int* w : weights)
+		{
+			*w = strtol(p, &p, 10);
+			if (*p == ',')
+				p++;
+		}
+	}
+	else if (name == "-comments")
+		shape.comment_ratio = atof(value);
+	else if (name == "-nesting")
+		shape.nesting = atoi(value);
+	else if (name == "-seed")
+		shape.seed = strtoul(value, NULL, 10);
+	else
+		return false;
+	return true;
+}
+
+
+string corpus_shape_usage()
+{
+	return
+		"        -bytes=n        Approximate size of the program in bytes.\n"
+		"        -identifiers=f  Share of operands that are identifiers rather than literals, 0 to 1.\n"
+		"        -literals=i,r,s,b  Relative weights of integer, real, string and boolean literals.\n"
+		"        -comments=f     Share of lines that are comments, 0 to 0.95.\n"
+		"        -nesting=n      Depth of nested procedures, ifs and whiles.\n"
+		"        -seed=n         Seed; the same flags and seed give the same program.\n";
+}
@@ -0,0 +1,33 @@
+#ifndef LILLE_CORPUS_H_
+#define LILLE_CORPUS_H_
+
+#include <string>
+
+using namespace std;
+
+struct corpus_shape {
+// What a generated Lille program is made of. Every program is syntactically valid and declares what it uses,
+// so it can be lexed, parsed or compiled.
+	size_t bytes = 1 << 20;				// Approximate size of the program.
+	double identifier_density = 0.5;	// Share of operands that are identifiers rather than literals.
+	int integer_weight = 4;				// Relative share of integer, real, string and boolean literals.
+	int real_weight = 2;
+	int string_weight = 1;
+	int boolean_weight = 1;
+	double comment_ratio = 0.1;			// Share of lines that are comments.
+	int nesting = 3;					// Depth of nested procedures, and of if and while statements in each.
+	unsigned seed = 1;					// The same shape and seed always give the same program.
+};
+
+string lille_corpus(const corpus_shape& shape);
+// A program of about shape.bytes bytes: global variables of every type, then procedures nested shape.nesting
+// deep, each full of assignments, ifs and whiles, repeated until the program is big enough.
+
+bool parse_corpus_shape(const string& flag, corpus_shape& shape);
+// Sets the field of shape named by a flag such as -bytes=4096, -identifiers=0.8, -literals=4,2,1,1,
+// -comments=0.1, -nesting=3 or -seed=7. Returns false if flag is not one of these.
+
+string corpus_shape_usage();
+// Help text for the flags parse_corpus_shape() accepts.
+
+#endif /* LILLE_CORPUS_H_ */
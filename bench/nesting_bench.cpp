@@ -0,0 +1,170 @@
+// Stress benchmark for deeply nested procedures.
+//
+// Generates programs whose procedures nest 10 to several thousand levels deep, then times the scanner, parser
+// and id_table on each. Then does the same for loops nested in one another, and for expressions nested in
+// parentheses and behind NOT. The deepest cases go past the parser's nesting budgets to check that they are
+// reported as errors rather than corrupting the symbol table or overflowing the stack. Last, procedures, loops
+// and parentheses are all nested as deep as their budgets allow at once, which must still fit the stack.
+//
+// Usage
+//        nesting_bench [reps]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+#include "lille_exception.h"
+#include "source_buffer.h"
+#include "error_handler.h"
+#include "name_table.h"
+#include "id_table.h"
+#include "scanner.h"
+#include "parser.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string bench_source_file_name = "nesting_bench.l";
+const int nesting_budget = 5000;			// parser::max_nesting
+
+
+void write_nested_program(int depth, int loops, int parentheses)
+// Each procedure declares the next one inside it; the innermost declares a variable and assigns it, inside
+// loops nested loops, the value wrapped in parentheses.
+{
+	ofstream out(bench_source_file_name);
+	out << "program deep is" << endl;
+	for (int i = 1; i <= depth; i++)
+		out << "procedure p" << i << "(a : value integer) is" << endl;
+	out << "x : integer;" << endl;
+	for (int i = depth; i >= 1; i--)
+	{
+		if (i == depth)
+		{
+			out << "begin" << endl;
+			for (int l = 0; l < loops; l++)
+				out << "loop" << endl;
+			out << "x := " << string(parentheses, '(') << "a" << string(parentheses, ')') << ";" << endl;
+			for (int l = 0; l < loops; l++)
+				out << "end loop;" << endl;
+			out << "end p" << i << ";" << endl;
+		}
+		else
+			out << "begin null; end p" << i << ";" << endl;
+	}
+	out << "begin null; end deep;" << endl;
+}
+
+
+void write_nested_expression(int depth, bool negated)
+// Assigns 1 wrapped in depth parentheses, or TRUE behind depth NOTs.
+{
+	ofstream out(bench_source_file_name);
+	out << "program deep is" << endl;
+	out << "x : integer;" << endl;
+	out << "b : boolean;" << endl;
+	out << "begin" << endl;
+	if (negated)
+	{
+		out << "b := ";
+		for (int i = 0; i < depth; i++)
+			out << "not ";
+		out << "true;" << endl;
+	}
+	else
+		out << "x := " << string(depth, '(') << "1" << string(depth, ')') << ";" << endl;
+	out << "end deep;" << endl;
+}
+
+
+bool compile(long long& micros)
+// Compile the generated program. Returns false if the compiler rejected it.
+{
+	bool ok = true;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+
+	source_buffer* source = new source_buffer(bench_source_file_name);
+	error_handler* err = new error_handler(source);
+	name_table* names = new name_table();
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(source, names, table, err);
+	parser* parse = new parser(scan, table, err);
+	try
+	{
+		scan->get_token();
+		while (scan->have(symbol::program_sym))
+			parse->PROG();
+		scan->must_be(symbol::end_of_program);
+		ok = (err->error_count() == 0);
+	}
+	catch (lille_exception& e)
+	{
+		ok = false;
+	}
+
+	micros = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+	delete parse;			// also deletes the scanner, id_table and error handler
+	delete names;
+	delete source;
+	return ok;
+}
+
+
+void time_program(int depth, int reps)
+// Compile the generated program reps times and report the best time.
+{
+	long long best = -1;
+	bool ok = true;
+	for (int r = 0; r < reps; r++)
+	{
+		long long micros;
+		ok = compile(micros);
+		if ((best < 0) or (micros < best))
+			best = micros;
+	}
+	cout << setw(8) << depth << setw(12) << best << setw(12) << fixed << setprecision(2) << (double) best / depth
+		 << "  " << (ok ? "ok" : "rejected") << endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int reps = (argc > 1) ? atoi(argv[1]) : 5;
+	const int depths[] = { 10, 100, 1000, 2500, 5000, 20000 };
+	const int statement_depths[] = { 10, 100, 1000, 4000, 50000 };
+	const int expression_depths[] = { 10, 100, 1000, 4000, 200000 };
+
+	cout << "procedures" << endl;
+	cout << setw(8) << "depth" << setw(12) << "best us" << setw(12) << "us/level" << "  result" << endl;
+	for (int depth : depths)
+	{
+		write_nested_program(depth, 0, 0);
+		time_program(depth, reps);
+	}
+	cout << "loops" << endl;
+	cout << setw(8) << "depth" << setw(12) << "best us" << setw(12) << "us/level" << "  result" << endl;
+	for (int depth : statement_depths)
+	{
+		write_nested_program(1, depth, 0);
+		time_program(depth, reps);
+	}
+	for (bool negated : { false, true })
+	{
+		cout << (negated ? "not" : "parentheses") << endl;
+		cout << setw(8) << "depth" << setw(12) << "best us" << setw(12) << "us/level" << "  result" << endl;
+		for (int depth : expression_depths)
+		{
+			write_nested_expression(depth, negated);
+			time_program(depth, reps);
+		}
+	}
+	cout << "procedures, loops and parentheses together" << endl;
+	cout << setw(8) << "depth" << setw(12) << "best us" << setw(12) << "us/level" << "  result" << endl;
+	write_nested_program(nesting_budget, nesting_budget, nesting_budget - 1);		// a PRIMARY() for each, and the value
+	time_program(nesting_budget, reps);
+	remove(bench_source_file_name.c_str());
+	return 0;
+}
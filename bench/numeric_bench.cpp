@@ -0,0 +1,186 @@
+// Benchmark for numeric literals.
+//
+// Generates a source file that is mostly table literals, rows of integers and reals in the forms the scanner
+// accepts, then times scanning it to the end. Every real is also checked against strtof, since from_chars
+// should give the same correctly rounded float, and every number must leave the comma or semicolon after it
+// to be scanned next. Reals past the range of a float are checked apart: too large is an error, too small is 0.
+//
+// Usage
+//        numeric_bench [rows] [reps]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <random>
+
+#include "lille_exception.h"
+#include "source_buffer.h"
+#include "error_handler.h"
+#include "name_table.h"
+#include "id_table.h"
+#include "scanner.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string bench_source_file_name = "numeric_bench.l";
+
+
+vector<string> write_table_program(int rows)
+// Writes rows of literals, eight to a row. Returns the text of every real, in order.
+{
+	mt19937 gen(12345);
+	uniform_int_distribution<int> digits(0, 999999);
+	uniform_int_distribution<int> form(0, 7);
+	uniform_int_distribution<int> exponent(-30, 30);
+	vector<string> reals;
+
+	ofstream out(bench_source_file_name);
+	out << "program tables is" << endl;
+	for (int r = 0; r < rows; r++)
+	{
+		for (int c = 0; c < 8; c++)
+		{
+			ostringstream lit;
+			switch (form(gen))
+			{
+			case 0:		lit << digits(gen); break;
+			case 1:		lit << digits(gen) % 1000 << "E" << digits(gen) % 4; break;
+			case 2:		lit << digits(gen) << "." << digits(gen); break;
+			case 3:		lit << digits(gen) % 100 << "." << setw(6) << setfill('0') << digits(gen) << "e" << exponent(gen); break;
+			case 4:		lit << "0." << setw(6) << setfill('0') << digits(gen) << "E+" << digits(gen) % 20; break;
+			case 5:		lit << "." << digits(gen); break;
+			case 6:		lit << "." << setw(6) << setfill('0') << digits(gen) << "e" << exponent(gen); break;
+			default:	lit << digits(gen) % 10 << "." << digits(gen) << digits(gen) << "e-" << digits(gen) % 30; break;
+			}
+			string text = lit.str();
+			if (text.find('.') != string::npos)
+				reals.push_back(text);
+			out << text << ((c < 7) ? ", " : ";");
+		}
+		out << endl;
+	}
+	out << "end tables;" << endl;
+	return reals;
+}
+
+
+long long scan_all(const vector<string>& reals, int& tokens, int& mismatches)
+// Scan the generated file to the end, comparing reals with strtof. Returns the time in microseconds.
+{
+	source_buffer* source = new source_buffer(bench_source_file_name);
+	error_handler* err = new error_handler(source);
+	name_table* names = new name_table();
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(source, names, table, err);
+
+	tokens = 0;
+	mismatches = 0;
+	size_t next_real = 0;
+	bool after_number = false;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	do
+	{
+		scan->get_token();
+		tokens++;
+		symbol::symbol_type sym = scan->this_token()->get_symbol().get_sym();
+		if (after_number and (sym != symbol::comma_sym) and (sym != symbol::semicolon_sym))
+			mismatches++;		// the number took the separator after it with it
+		after_number = (sym == symbol::integer) or (sym == symbol::real_num);
+		if (sym == symbol::real_num)
+		{
+			float expected = strtof(reals[next_real++].c_str(), NULL);
+			float got = scan->this_token()->get_real_value();
+			if (memcmp(&expected, &got, sizeof(float)) != 0)
+				mismatches++;
+		}
+	} while (!scan->have(symbol::end_of_program));
+	long long micros = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+	if (err->error_count() != 0)
+		mismatches++;
+	delete scan;
+	delete table;
+	delete err;
+	delete names;
+	delete source;
+	return micros;
+}
+
+
+int check_out_of_range()
+// Scans reals past the range of a float, whose digits and exponent point different ways. Returns the number that
+// are not flagged as too large, if they are, or not read as 0 without an error, if they are too small.
+{
+	struct { string text; bool too_large; } cases[] = {
+		{ "1" + string(60, '0') + ".0e-5", true },
+		{ "1" + string(60, '0') + ".5e-10", true },
+		{ "1.0e39", true },
+		{ "0." + string(60, '0') + "1e5", false },
+		{ "." + string(60, '0') + "1e+10", false },
+		{ "1.0e-50", false }
+	};
+	int mismatches = 0;
+	for (auto& c : cases)
+	{
+		ofstream(bench_source_file_name) << "program ranges is" << endl << c.text << ";" << endl << "end ranges;" << endl;
+		source_buffer* source = new source_buffer(bench_source_file_name);
+		error_handler* err = new error_handler(source);
+		name_table* names = new name_table();
+		id_table* table = new id_table(err, names);
+		scanner* scan = new scanner(source, names, table, err);
+		vector<error_handler::held_error> errors;
+		err->hold_errors(&errors);
+
+		do
+			scan->get_token();
+		while (!scan->have(symbol::real_num) and !scan->have(symbol::end_of_program));
+		bool flagged = (errors.size() == 1) and (errors[0].err_no == 66);
+		if (c.too_large ? !flagged : (!errors.empty() or (scan->this_token()->get_real_value() != 0.0)))
+		{
+			cout << c.text << (c.too_large ? " not flagged as too large" : " not read as 0") << endl;
+			mismatches++;
+		}
+
+		err->hold_errors(NULL);
+		delete scan;
+		delete table;
+		delete err;
+		delete names;
+		delete source;
+	}
+	return mismatches;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int rows = (argc > 1) ? atoi(argv[1]) : 20000;
+	int reps = (argc > 2) ? atoi(argv[2]) : 5;
+
+	vector<string> reals = write_table_program(rows);
+	long long best = -1;
+	int tokens = 0;
+	int mismatches = 0;
+	for (int r = 0; r < reps; r++)
+	{
+		long long micros = scan_all(reals, tokens, mismatches);
+		if ((best < 0) or (micros < best))
+			best = micros;
+	}
+	mismatches += check_out_of_range();
+
+	cout << setw(10) << "tokens" << setw(10) << "reals" << setw(12) << "best us" << setw(12) << "ns/token"
+		 << "  result" << endl;
+	cout << setw(10) << tokens << setw(10) << reals.size() << setw(12) << best << setw(12) << fixed
+		 << setprecision(1) << 1000.0 * best / tokens << "  "
+		 << ((mismatches == 0) ? "exact" : to_string(mismatches) + " mismatches") << endl;
+	remove(bench_source_file_name.c_str());
+	return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+// Check and benchmark for incremental lexing.
+//
+// Generates a Lille program, pretokenizes it, then makes random edits to it with scanner::relex(), as an editor
+// integration would after each keystroke. After every edit the tokens and errors of the edited scanner are
+// checked against those of a new scanner over the whole of the edited text, and the token range relex() returned
+// is checked against the tokens before and after the edit. Edits insert and remove line breaks, comments,
+// quotes, literals and pragmas, so lexing sometimes has to carry on past the lines an edit touches. Reports the
+// time relex() took against lexing the whole source again. Exits with status 1 at the first mismatch.
+//
+// Usage
+//        relex_bench [-edits=n] [corpus flags]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <algorithm>
+
+#include "lille_exception.h"
+#include "source_buffer.h"
+#include "error_handler.h"
+#include "name_table.h"
+#include "id_table.h"
+#include "scanner.h"
+#include "lille_corpus.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string bench_source_file_name = "relex_bench.l";
+
+struct lexed_token {
+	symbol::symbol_type sym;
+	uint32_t offset;
+	string value;			// Name ID, number or string the token carries, if any.
+};
+
+
+bool same(const lexed_token& a, const lexed_token& b, int64_t shift)
+// True if a, moved shift bytes, is b.
+{
+	return (a.sym == b.sym) and (a.offset + shift == b.offset) and (a.value == b.value);
+}
+
+
+vector<lexed_token> walk(scanner* scan, error_handler* err, vector<error_handler::held_error>& errors)
+// Every token from the first to end_of_program, as get_token() returns them, with the errors reported on the way.
+// A malformed identifier is an end_of_program too, so the end is the end_of_program that get_token() repeats.
+{
+	vector<lexed_token> lexed;
+	errors.clear();
+	err->hold_errors(&errors);
+	for (;;)
+	{
+		token* t = scan->get_token();
+		lexed_token l = { t->get_sym(), t->get_offset(), "" };
+		switch (l.sym)
+		{
+		case symbol::identifier:	l.value = to_string(t->get_name_id()); break;
+		case symbol::integer:		l.value = to_string(t->get_integer_value()); break;
+		case symbol::real_num:		l.value = to_string(t->get_payload()); break;
+		case symbol::strng:			l.value = t->get_string_value(); break;
+		default:					break;
+		}
+		if ((l.sym == symbol::end_of_program) and !lexed.empty() and same(lexed.back(), l, 0))
+			break;
+		lexed.push_back(l);
+	}
+	err->hold_errors(NULL);
+	return lexed;
+}
+
+
+vector<lexed_token> lex_afresh(source_buffer* text, name_table* names, vector<error_handler::held_error>& errors,
+		long long& micros)
+// Every token of text, pretokenized from scratch in the same name table. Micros is set to the time lexing took.
+{
+	error_handler* err = new error_handler(text);
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(text, names, table, err);
+
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	scan->pretokenize();
+	micros = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+	vector<lexed_token> lexed = walk(scan, err, errors);
+	delete scan;
+	delete table;
+	delete err;
+	return lexed;
+}
+
+
+string check_range(const vector<lexed_token>& before, const vector<lexed_token>& after, scanner::token_range r,
+		int64_t shift)
+// Why r does not hold every token that differs between before and after, or "" if it does. A token that now
+// follows a pragma, or no longer does, is in the range too, though nothing here shows it. Token 0 of the stream is
+// the one current before the first get_token(), so the token at index i of before and after is token i + 1.
+{
+	if (r.first < 1)
+		return "range starts before the first token";
+	size_t first = r.first - 1;
+	if ((first + r.removed > before.size()) or (first + r.inserted > after.size())
+			or (before.size() - r.removed != after.size() - r.inserted))
+		return "range does not fit the tokens";
+	for (size_t i = 0; i < first; i++)
+		if (!same(before[i], after[i], 0))
+			return "token " + to_string(i + 1) + " before the range changed";
+	for (size_t i = first + r.removed; i < before.size(); i++)
+		if (!same(before[i], after[i - r.removed + r.inserted], shift))
+			return "token " + to_string(i + 1) + " after the range changed";
+	return "";
+}
+
+
+string random_insertion(mt19937& gen, const string& text)
+// Text an edit inserts: a fragment that changes how the lines around it are lexed, or a piece of the source.
+{
+	static const vector<string> fragments = {
+		"", "x", " ", "\n", ";", ":=", "(", ")", "\"", "\"a \"\"quoted\"\" string\"", "--", "-- comment\n", ".5",
+		"1.5e3", "42", "e", "begin", "end ", "pragma trace(", "pragma debug(on);\n", "#", "\n\"\n"
+	};
+	uniform_int_distribution<size_t> pick(0, fragments.size());
+	size_t f = pick(gen);
+	if (f < fragments.size())
+		return fragments[f];
+	uniform_int_distribution<size_t> at(0, text.size());
+	size_t from = at(gen);
+	return text.substr(from, uniform_int_distribution<size_t>(0, 24)(gen));
+}
+
+
+int main(int argc, char *argv[])
+{
+	int edits = 400;
+	corpus_shape shape;
+	shape.bytes = 64 << 10;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.rfind("-edits=", 0) == 0)
+			edits = max(1, atoi(arg.c_str() + 7));
+		else if (!parse_corpus_shape(arg, shape))
+		{
+			cerr << "Usage: " << argv[0] << " [-edits=n] [corpus flags]" << endl
+				 << "    Corpus flags are:" << endl << corpus_shape_usage();
+			return (arg == "-h") ? 0 : 1;
+		}
+	}
+
+	string text = lille_corpus(shape);
+	ofstream(bench_source_file_name, ios::binary) << text;
+	source_buffer* source = new source_buffer(bench_source_file_name);
+	error_handler* err = new error_handler(source);
+	name_table* names = new name_table();
+	id_table* table = new id_table(err, names);
+	scanner* scan = new scanner(source, names, table, err);
+	scan->pretokenize();
+
+	vector<error_handler::held_error> errors;
+	vector<lexed_token> before = walk(scan, err, errors);
+	source_buffer* edited = source;			// the edited text, kept apart from the scanner's copy of it
+
+	mt19937 gen(shape.seed);
+	long long relex_micros = 0;
+	long long full_micros = 0;
+	size_t changed_tokens = 0;
+	string failure;
+	int e;
+	for (e = 1; (e <= edits) and failure.empty(); e++)
+	{
+		uint32_t offset = uniform_int_distribution<uint32_t>(0, text.size())(gen);
+		uint32_t removed = uniform_int_distribution<uint32_t>(0, min<uint32_t>(16, text.size() - offset))(gen);
+		string inserted = random_insertion(gen, text);
+		int64_t shift = int64_t(inserted.size()) - removed;
+
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		scanner::token_range r = scan->relex(offset, removed, inserted);
+		relex_micros += duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+		changed_tokens += r.removed + r.inserted;
+		vector<lexed_token> after = walk(scan, err, errors);
+
+		source_buffer* previous = edited;
+		edited = new source_buffer(previous, offset, removed, inserted);
+		delete previous;
+		text.replace(offset, removed, inserted);
+
+		long long micros;
+		vector<error_handler::held_error> expected_errors;
+		vector<lexed_token> expected = lex_afresh(edited, names, expected_errors, micros);
+		full_micros += micros;
+
+		if (after.size() != expected.size())
+			failure = to_string(after.size()) + " tokens where lexing again gives " + to_string(expected.size());
+		for (size_t i = 0; (i < after.size()) and failure.empty(); i++)
+			if (!same(after[i], expected[i], 0))
+				failure = "token " + to_string(i + 1) + " differs from lexing again";
+		if (failure.empty() and (errors.size() != expected_errors.size()))
+			failure = to_string(errors.size()) + " errors where lexing again finds " + to_string(expected_errors.size());
+		for (size_t i = 0; (i < errors.size()) and failure.empty(); i++)
+			if ((errors[i].offset != expected_errors[i].offset) or (errors[i].err_no != expected_errors[i].err_no))
+				failure = "error " + to_string(i + 1) + " differs from lexing again";
+		if (failure.empty())
+			failure = check_range(before, after, r, shift);
+		if (!failure.empty())
+			failure = "edit " + to_string(e) + " (" + to_string(removed) + " bytes at " + to_string(offset)
+					+ " replaced by \"" + inserted + "\"): " + failure;
+		before = after;
+	}
+	remove(bench_source_file_name.c_str());
+
+	if (!failure.empty())
+	{
+		cout << "relex FAILED at " << failure << endl;
+		return 1;
+	}
+	cout << "relex: " << edits << " edits to " << text.size() << " bytes, " << before.size() << " tokens, matched lexing"
+		 << " again" << endl;
+	cout << setw(24) << "us per edit, relex" << setw(10) << fixed << setprecision(1) << double(relex_micros) / edits
+		 << setw(16) << "whole source" << setw(10) << double(full_micros) / edits << setw(10)
+		 << double(changed_tokens) / edits << " tokens changed per edit" << endl;
+	return 0;
+}
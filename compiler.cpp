@@ -1,10 +1,13 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <string>
 #include <chrono>
 #include <map>
+#include <vector>
 #include <iterator>
+#include <cstdlib>
 
 #include "lille_exception.h"
 #include "scanner.h"
@@ -13,6 +16,9 @@
 #include "error_handler.h"
 //#include "code_gen.h"
 #include "id_table.h"
+#include "source_buffer.h"
+#include "name_table.h"
+#include "time_report.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -22,27 +28,42 @@ const string default_source_file_name = "SOURCE";	// Default source code file na
 const string default_code_filename = "CODE";	// Default code file name if one not specified on command line
 
 bool listing_required {false};							// Should a listing file be generated?
+bool time_report_required {false};						// Should the time spent in each phase be reported?
+bool time_report_json {false};							// Report the phases as JSON rather than as a table?
+bool pretokenize_required {false};						// Should the whole source be scanned before parsing starts?
+int lex_threads {1};									// Threads to scan it with, if so.
+bool ast_required {false};								// Should the syntax tree be printed?
+string edits_filename;									// Edit script to compile the source again after each edit of, if any.
 
 string source_filename;							// Name of the source file containing DO code to be compiled.
 string code_filename;							// Name of the PAL output file to be generated.
 string listing_filename;						// name of the listing file to be generated if needed.
 
+source_buffer* source;							// source file mapped into memory, shared by the scanner and error handler
 error_handler* err;								// error handler object
+name_table* names;								// identifier names, interned by the scanner and shared with the symbol table
 scanner* scan;									// scanner object
 parser* parse;									// parser object
 id_table* id_tab = NULL;								// symbol table object
+time_report* timings = NULL;							// phase timings and counters, if requested
 //code_gen* code;									// code generator
 
 bool process_command_line(int argc, char *argv[]) {
 	// Process the command line and identify flags that are set and any filenames provided.
 	// Usage
 	//        do [flags] filename
-	// where filename contains the source code to be compiler.
+	// where filename contains the source code to be compiler, or is - for standard input.
 	//
 	// Flags are:
 	//		-l 				Generate a listing file
 	//		-o filename  	Generate code file with the specified name
 	//		-h				Generate help instructions
+	//		-time-report	Report the time spent in each phase of the compiler
+	//		-time-report=json	As above, as a line of JSON
+	//		-pretokenize	Scan the whole source into arrays before parsing
+	//		-lex-threads=n	As -pretokenize, splitting a large source between n threads
+	//		-ast			Print the syntax tree built by the parser
+	//		-edits=filename	Compile again after each edit in filename, lexing again only what it changed
 
 	bool hflag = false;		// help flag set
 	bool sflag = false;		// source filename provided
@@ -72,6 +93,8 @@ bool process_command_line(int argc, char *argv[]) {
 					hflag = true;	// Note that help has already been given. Once present it once
 					cout << "Usage: " << argv[0] << " [flags] filename" << endl;
 					cout << "    where filename is the name of the file to be compiled into PAL code." << endl;
+					cout << "    A filename of - reads the source from standard input. Standard input and pipes" << endl;
+					cout << "    are read as the compilation goes, so the source is never held in memory." << endl;
 					cout << "    Valid flags are:" << endl;
 					cout << "        -h              Print out this help message." << endl;
 					cout << "        -l              Create a listing file showing source code and all errors" << endl;
@@ -80,6 +103,22 @@ bool process_command_line(int argc, char *argv[]) {
 					cout << "        -o filename     The generated code file (PAL code) is named filename." << endl;
 					cout << "                        If this flag is not present, then the default name of" << endl;
 					cout << "                        of the code file is " << default_code_filename << endl;
+					cout << "        -time-report    Report the time spent in the scanner, parser, symbol table," << endl;
+					cout << "                        error handling and output, with token, lookup and error counts." << endl;
+					cout << "        -time-report=json  As -time-report, written as a single line of JSON." << endl;
+					cout << "        -pretokenize    Scan the whole source file before parsing it. Uses more" << endl;
+					cout << "                        memory but parses faster; the results are the same." << endl;
+					cout << "        -lex-threads=n  As -pretokenize, with large source files split into n parts" << endl;
+					cout << "                        at line boundaries and scanned at the same time." << endl;
+					cout << "        -ast            Print the syntax tree of the program on standard output." << endl;
+					cout << "        -edits=script   As -pretokenize, then compile again after each edit in the file" << endl;
+					cout << "                        script, as an editor does after each change. Each edit is a line" << endl;
+					cout << "                        holding the byte offset, the bytes removed and the bytes inserted," << endl;
+					cout << "                        followed by the text inserted and a newline. Only the lines an" << endl;
+					cout << "                        edit touches are scanned again; the tokens it changed and the" << endl;
+					cout << "                        errors then found are reported. The script may be a pipe the" << endl;
+					cout << "                        editor writes to. Output, the listing and -ast are for the" << endl;
+					cout << "                        source as last edited." << endl;
 				}
 			}
 			else if (arg == "-l")
@@ -88,6 +127,44 @@ bool process_command_line(int argc, char *argv[]) {
 				listing_required = true;	// Set global flag to show that a listing is required.
 				// Name of listing file is based on the name of the source file. It is set up after the command line is processed.
 			}
+			else if ((arg == "-time-report") or (arg == "-time-report=json"))
+			{
+				// Report per phase timings and counters on stderr once the compilation is complete.
+				time_report_required = true;
+				time_report_json = (arg == "-time-report=json");
+			}
+			else if (arg == "-pretokenize")
+			{
+				// Lex the whole compilation unit into a token stream before the parser starts.
+				pretokenize_required = true;
+			}
+			else if (arg.rfind("-lex-threads=", 0) == 0)
+			{
+				// Lex the whole compilation unit up front, on several threads.
+				lex_threads = atoi(arg.substr(13).c_str());
+				if (lex_threads < 1)
+				{
+					cerr << "Illegal flag: " << arg << endl;
+					return false;
+				}
+				pretokenize_required = true;
+			}
+			else if (arg == "-ast")
+			{
+				// Print the syntax tree once the source has been parsed.
+				ast_required = true;
+			}
+			else if (arg.rfind("-edits=", 0) == 0)
+			{
+				// Compile again after each edit in the script, relexing only the lines it touches.
+				edits_filename = arg.substr(7);
+				if (edits_filename.empty())
+				{
+					cerr << "Illegal flag: " << arg << endl;
+					return false;
+				}
+				pretokenize_required = true;
+			}
 			else if (arg == "-o")
 			{
 				// Generate a named output file holding the PAL code.
@@ -105,8 +182,8 @@ bool process_command_line(int argc, char *argv[]) {
 			else
 			{
 				// no flag, so this must be the name of the source file.
-				// First check to make sure it isn;t an invalid flag
-				if (arg.at(0) == '-')
+				// First check to make sure it isn;t an invalid flag. A lone "-" means standard input.
+				if ((arg.at(0) == '-') and (arg != "-"))
 				{
 					cerr << "Illegal flag: " << arg << endl;
 					return false;
@@ -129,6 +206,13 @@ bool process_command_line(int argc, char *argv[]) {
 			if (!cflag)
 				code_filename = default_code_filename;
 		}
+		else if (source_filename == "-")
+		{
+			// Source read from standard input; there is no file name to base the others on.
+			listing_filename = default_listing_file_name;
+			if (!cflag)
+				code_filename = default_code_filename;
+		}
 		else
 		{
 			root_filename = source_filename.substr(0, source_filename.find(".")); 	// The root filename is up to the first "." character
@@ -143,6 +227,76 @@ bool process_command_line(int argc, char *argv[]) {
 }
 
 
+vector<ast::node_id> parse_programs()
+// Parse every program in the source from the scanner's first token on. Returns the root of the syntax tree of each.
+{
+	time_report::phase_guard timing(time_report::parser_phase);
+	vector<ast::node_id> programs;
+	scan->get_token();
+	while (scan->have(symbol::program_sym))
+		programs.push_back(parse->PROG());
+	scan->must_be(symbol::end_of_program);
+	return programs;
+}
+
+
+bool read_edit(istream& script, uint32_t& offset, uint32_t& removed, string& inserted)
+// Read the next edit of an edit script: a line holding the offset, the number of bytes removed and the number
+// inserted, then the text inserted and a newline. Returns false at the end of the script.
+{
+	string header;
+	do
+	{
+		if (!getline(script, header))
+			return false;
+	} while (header.empty());
+
+	istringstream fields(header);
+	size_t length;
+	if (!(fields >> offset >> removed >> length))
+		throw lille_exception("Malformed edit: " + header);
+	inserted.assign(length, ' ');
+	script.read(inserted.data(), length);
+	if (size_t(script.gcount()) != length)
+		throw lille_exception("Edit script ends in the text of an edit.");
+	script.ignore(1);			// the newline after the text
+	return true;
+}
+
+
+void apply_edits(vector<ast::node_id>& programs)
+// Compile the source again after each edit of the edit script, as an editor would after each change. The
+// scanner lexes only the lines an edit touches; the parser and symbol table start again from scratch.
+{
+	ifstream script(edits_filename);
+	if (!script)
+		throw lille_exception("Edit script " + edits_filename + " cannot be opened.");
+
+	uint32_t offset, removed;
+	string inserted;
+	for (int n = 1; read_edit(script, offset, removed, inserted); n++)
+	{
+		scanner::token_range changed = scan->relex(offset, removed, inserted);
+		parse->restart(new id_table(err, names));
+		programs = parse_programs();
+		cout << "Edit " << n << " replaced " << changed.removed << " tokens from token " << changed.first << " by "
+			 << changed.inserted << "; " << err->error_count() << " errors found." << endl;
+	}
+}
+
+
+void report_times()
+// Write the phase timings and counters to stderr, if they were requested.
+{
+	if (timings == NULL)
+		return;
+	if (time_report_json)
+		timings->print_json(cerr, source_filename);
+	else
+		timings->print_table(cerr, source_filename);
+}
+
+
  int main(int argc, char *argv[])
  {
 	// local variables used to measure and report elapsed time
@@ -161,33 +315,51 @@ bool process_command_line(int argc, char *argv[]) {
 
 	if (status)
 	{
+		if (time_report_required)
+			timings = new time_report();		// everything up to the first token is charged to setup
+
 		try
 		{
+			// Map the source file once; the scanner and the listing both read from this buffer.
+			source = new source_buffer(source_filename);
+
 			if (!listing_required)
-				err = new error_handler(source_filename);
+				err = new error_handler(source);
 			else
-				err = new error_handler(source_filename, listing_filename);
+				err = new error_handler(source, listing_filename);
+
+			// Identifiers are interned once, by the scanner, and looked up by ID in the symbol table.
+			names = new name_table();
 
 			// Create a symbol_table object
-			id_table* table = new id_table(err);
+			id_table* table = new id_table(err, names);
 
 			// create a scanner object
-            scan = new scanner(source_filename, id_tab, err);
+            scan = new scanner(source, names, id_tab, err);
 			
 			// create the code generator
 
 			// create a parser object
 			parse = new parser(scan, table, err);
-			
-			scan->get_token();
-			while(scan->have(symbol::program_sym)){
-				parse->PROG();
+			if (pretokenize_required)
+			{
+				time_report::phase_guard timing(time_report::parser_phase);
+				scan->pretokenize(lex_threads);
 			}
-			scan->must_be(symbol::end_of_program);
+			vector<ast::node_id> programs = parse_programs();	// root of the syntax tree of each program parsed
+			if (!edits_filename.empty())
+				apply_edits(programs);
 
 			// Compile the source code
+			time_report::phase_guard timing(time_report::output_phase);
 			
 			// Generate the PAL code file, if no errors were detected.
+			if (ast_required)
+				for (ast::node_id program : programs)
+					parse->syntax_tree()->print(program, cout);
+
+			// The tree is no longer needed; it is freed in one go, however large it is.
+			parse->syntax_tree()->release();
 
 			// Generate a listing, if required.
 			if (listing_required)
@@ -201,14 +373,16 @@ bool process_command_line(int argc, char *argv[]) {
 		catch (lille_exception &e)
 		{
 			cerr << "Exception: " << e.what() << endl;
+			report_times();
 			return 1;
 		}
 		catch (exception &e)
 		{
 			cerr << "Exception: " << e.what() << endl;
+			report_times();
 			return 1;
 		}
-
+		report_times();
 	}
 	return 0;
 }
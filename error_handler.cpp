@@ -3,10 +3,13 @@
 #include <filesystem>
 #include <string>
 #include <iomanip>
+#include <algorithm>
 
 #include "token.h"
 #include "lille_exception.h"
 #include "error_handler.h"
+#include "source_buffer.h"
+#include "time_report.h"
 
 using namespace std;
 
@@ -17,60 +20,49 @@ error_handler::error_handler()
 	recovering = true;
 	error_num = 0;
 	err_list = NULL;
+	held = NULL;
+	listed_errors = 0;
+	streamed_lines = 0;
 	listing_required = false;
 	initialize_error_messages();
 	error_limit = 10000;
 	listing_filename = "";
-	if (filesystem::exists(string(default_source_file_name)))
-	{	// Check file exists
-		source_file.open(default_source_file_name); // Open source file for reading.
-	}
-	else
-{
-		cerr << "File named \"" + default_source_file_name + "\" does not exist." << endl;
-		throw("File named \"" + default_source_file_name + "\" does not exist.");
-}
+	source = new source_buffer(default_source_file_name);		// Raises an exception if the file does not exist.
 	listing_file.open(default_listing_file_name);
 }
 
 
-error_handler::error_handler(string source_file_name)
+error_handler::error_handler(source_buffer* src)
 // Constructor. No listing file needed
 {
 	recovering = true;
 	error_num = 0;
 	err_list = NULL;
+	held = NULL;
+	listed_errors = 0;
+	streamed_lines = 0;
 	listing_required = false;
 	initialize_error_messages();
 	error_limit = 10000;
 	listing_filename = "";
-
-	if (filesystem::exists(source_file_name))
-	{		// Check file exists
-		source_file.open(source_file_name); // Open source file for reading.
-	}
-	else
-		throw("File named \"" + source_file_name + "\" does not exist.");
-	// listing_file.open(default_listing_file_name);
+	source = src;
 }
 
 
-error_handler::error_handler(string source_file_name, string list_file_name)
+error_handler::error_handler(source_buffer* src, string list_file_name)
 // Constructor. Specifies name of listing file.
 {
 	recovering = true;
-	listing_required = true;
 	error_num = 0;
+	err_list = NULL;
+	held = NULL;
+	listed_errors = 0;
+	streamed_lines = 0;
 	listing_required = true;
 	listing_filename = list_file_name;
 	initialize_error_messages();
 	error_limit = 10000;
-	if (filesystem::exists(string(source_file_name)))
-	{		// Check file exists
-		source_file.open(source_file_name); // Open source file for reading.
-	}
-	else
-		throw("File named \"" + source_file_name + "\" does not exist.");
+	source = src;
 }
 
 
@@ -202,6 +194,7 @@ void error_handler::initialize_error_messages()
 	error_message[121] = "Function call expected.";
 	error_message[122] = "Formal and actual parameter types do not match.";
 	error_message[123] = "Functions can only have value parameters.";
+	error_message[125] = "Procedures, functions, statements or expressions nested too deeply.";
 }
 
 
@@ -251,12 +244,21 @@ void error_handler::add_error_to_list(int line, int pos, int err)
 	}
 }
 
-void error_handler::flag(int line_number, int pos_on_line, int error_no)
+void error_handler::flag(uint32_t offset, int error_no)
 // Error detected by scanner at specified position.
 {
+	if (held != NULL)
+	{
+		held->push_back({offset, error_no});
+		return;
+	}
+	time_report::phase_guard timing(time_report::error_phase);
+	time_report::count(time_report::errors_counter);
 	error_num++;
 	if (error_num <= error_limit)
 	{
+		int line_number, pos_on_line;
+		source->locate(offset, line_number, pos_on_line);
 		cerr << "ERROR: " << error_message[error_no] << " Error at (" << line_number << ", " << pos_on_line << ")." << endl;
 		add_error_to_list(line_number, pos_on_line, error_no);
 	}
@@ -268,11 +270,15 @@ void error_handler::flag(token* tok, int error_no)
 {
 	// Generate an error message and retain the token and message in an appropriate data structure
 	// so that a listing file can be generated at the completion of the compilation.
+	time_report::phase_guard timing(time_report::error_phase);
+	time_report::count(time_report::errors_counter);
 	error_num++;
 	if (error_num <= error_limit)
 	{
-		cerr << "*** ERROR: " << error_message[error_no] << " Error #"  << error_no << " at (" << tok->get_line_number() << ", " << tok->get_pos_on_line() << ")." << endl;
-		add_error_to_list(tok->get_line_number(), tok->get_pos_on_line(), error_no);
+		int line_number, pos_on_line;
+		source->locate(tok->get_offset(), line_number, pos_on_line);
+		cerr << "*** ERROR: " << error_message[error_no] << " Error #"  << error_no << " at (" << line_number << ", " << pos_on_line << ")." << endl;
+		add_error_to_list(line_number, pos_on_line, error_no);
 	}
 }
 
@@ -283,23 +289,137 @@ void error_handler::set_error_limit(int i)
 }
 
 
-void error_handler::generate_listing()
-// generate a listing file.
+void error_handler::set_source(source_buffer* src)
+// The errors found so far were found in the old source, and will be found again as the new one is compiled.
+{
+	source = src;
+	while (err_list != NULL)
+	{
+		error_list* forgotten = err_list;
+		err_list = err_list->next;
+		delete forgotten;
+	}
+	error_num = 0;
+	listed_errors = 0;
+	recovering = true;
+}
+
+
+void error_handler::hold_errors(vector<held_error>* h)
+{
+	held = h;
+}
+
+
+void error_handler::list_line(int line_number, const string& text)
+// Write a line of the listing. Errors on this line, or on earlier lines not yet listed, are listed directly
+// beneath it, with a marker under the offending symbol.
 {
-	error_list* error_this_line;
-	int line_number {1};
-	int err_count = 0;
-	string source_line;
 	const int no_width = 4;
 	const int space = 1;
-	bool enter_loop {false};
+
+	listing_file << setw(no_width) << line_number << string(space, ' ') << text << endl;
+	while ((err_list != NULL) and (err_list->line_no <= line_number))
+	{
+		listing_file << string(no_width + space + max(err_list->pos_no, 0), ' ') << "^" << endl;
+		listing_file << "*** ERROR: " << error_message[err_list->err_no] << " Error #" << err_list->err_no << endl;
+		listed_errors++;
+		error_list* listed = err_list;
+		err_list = err_list->next;
+		delete listed;
+	}
+}
+
+
+void error_handler::source_line(int line_number, const char* start, const char* end)
+// The listing of a streamed source is written as it goes. A line is held back until settled() says no more errors
+// can be found on it, as the parser may flag an expression many lines behind the scanner.
+{
+	if (!listing_required)
+		return;
+	unlisted_lines.push_back({line_number, string(start, end)});
+	streamed_lines = line_number;
+}
+
+
+void error_handler::settled(uint32_t offset)
+{
+	if (unlisted_lines.empty())
+		return;
+	time_report::phase_guard timing(time_report::error_phase);
+	int line_number, pos_on_line;
+	source->locate(offset, line_number, pos_on_line);
+	if (unlisted_lines.front().first >= line_number)
+		return;
+	if (!listing_file.is_open())
+		listing_file.open(listing_filename);
+	while (!unlisted_lines.empty() and (unlisted_lines.front().first < line_number))
+	{
+		list_line(unlisted_lines.front().first, unlisted_lines.front().second);
+		unlisted_lines.pop_front();
+	}
+}
+
+
+void error_handler::generate_listing()
+// generate a listing file.
+{
+	time_report::phase_guard timing(time_report::error_phase);
 
 	if (listing_required)
 	{
 		// GENERATE THE LISTING FILE.
+		if (source->is_streamed())
+		{
+			// Most of it has been written already; finish the lines still held back, then any the scanner
+			// never reached because compilation stopped early.
+			if (!listing_file.is_open())
+				listing_file.open(listing_filename);
+			for (pair<int, string>& line : unlisted_lines)
+				list_line(line.first, line.second);
+			unlisted_lines.clear();
+
+			int line_number = streamed_lines + 1;
+			const char* line_start = source->unread_text();
+			const char* line_end;
+			while (true)
+			{
+				const char* next_line = source->next_line(line_start, line_end);
+				if ((line_start == line_end) and (line_end == source->end()))
+					break;		// the end, or the empty line after a final '\n'
+				list_line(line_number, string(line_start, line_end));
+				line_start = next_line;
+				line_number++;
+			}
+		}
+		else
+		{
+			// The lines are taken straight from the source buffer the scanner used, so the file is not read again.
+			listing_file.open(listing_filename);
+			int line_number {1};
+			const char* line_start = source->begin();
+			const char* line_end;
+			while (line_start < source->end())
+			{
+				const char* next_line = source->next_line(line_start, line_end);
+				list_line(line_number, string(line_start, line_end));
+				line_start = next_line;
+				line_number++;
+			}
+		}
+
+		// errors detected at the end of the file, after the last line.
+		while (err_list != NULL)
+		{
+			listing_file << "*** ERROR: " << error_message[err_list->err_no] << " Error #" << err_list->err_no << endl;
+			listed_errors++;
+			error_list* listed = err_list;
+			err_list = err_list->next;
+			delete listed;
+		}
 
-		// INSERT CODE HERE.
-		
+		listing_file << endl << listed_errors << " errors found." << endl;
+		listing_file.close();
 	}
 	// else do nothing since no listing file name was provided.
 }
@@ -5,21 +5,26 @@
 #include <fstream>
 #include <filesystem>
 #include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
 
 #include "token.h"
 #include "lille_exception.h"
+#include "source_buffer.h"
 
 using namespace std;
 
 class error_handler {
 private:
-	error_handler();									// Construct. No source file listed. Use cin.
+	error_handler();									// Construct. No source file listed. Use the default source file.
 	string listing_filename;
 	bool recovering;
 	string default_listing_file_name = "LISTING";
 	string default_source_file_name = "SOURCE";	
 	bool listing_required;
-	ifstream source_file;
+	source_buffer* source;								// Source text shared with the scanner. Used to produce the listing.
 	ofstream listing_file;
 	int error_num;
 	int error_limit;
@@ -31,7 +36,13 @@ private:
 		error_list* next;
 	};
 
-	error_list* err_list;
+	error_list* err_list;								// Errors not listed yet, in order of position.
+	int listed_errors;									// Errors written to the listing so far.
+
+	deque<pair<int, string>> unlisted_lines;			// Line numbers and text of the lines of a streamed source held
+														// back from the listing, as errors may still be found on them.
+	int streamed_lines;									// Lines of a streamed source scanned so far.
+	void list_line(int line_number, const string& text);	// Write a line and its errors to the listing.
 	
 
 	static const int max_error_message_index = 150;		// There are 100 error messages that can be generated by the compiler.
@@ -39,14 +50,32 @@ private:
 	void initialize_error_messages();					// set up the array of error messages
 	void add_error_to_list(int line, int pos, int err);
 
+public:
+	struct held_error {									// An error found by the scanner ahead of the parser.
+		uint32_t offset;
+		int err_no;
+	};
+
+private:
+	vector<held_error>* held;							// If not NULL, scanner errors are added here rather than reported.
+
 public:		
 	void stopRecovery();
-	error_handler(string source_file_name);								// Constructor. No listing file needed
-	error_handler(string source_file_name, string list_file_name);		// Constructor. Specifies name of listing file
+	error_handler(source_buffer* src);									// Constructor. No listing file needed
+	error_handler(source_buffer* src, string list_file_name);			// Constructor. Specifies name of listing file
 
-	void flag(int line_number, int pos_on_line, int error_no);			// Error detected by scanner at specified position.
+	void flag(uint32_t offset, int error_no);							// Error detected by scanner offset bytes into the source.
 	void flag(token* tok, int error_no);								// Error detected at token tok.
 	void set_error_limit(int i);
+	void set_source(source_buffer* src);								// Locate and list errors in src from now on, as after
+																		// the source has been edited. Errors found so far are forgotten.
+	void hold_errors(vector<held_error>* h);							// Until called again with NULL, add errors from flag(offset, n)
+																		// to h instead of reporting them, so they can be reported later
+																		// in the order the parser reaches them.
+	void source_line(int line_number, const char* start, const char* end);	// Line of a streamed source that has
+																		// just been scanned, to be listed.
+	void settled(uint32_t offset);										// No error will be flagged before offset from now on, so
+																		// the lines of a streamed source before its line can be listed.
 	void generate_listing();											// Generate a listing file.
 	int error_count();											     	// Number of errors found so far.
 	void syntax(symbol::symbol_type s, token* tok, int msg);	
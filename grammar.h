@@ -0,0 +1,118 @@
+#ifndef GRAMMAR_H_
+#define GRAMMAR_H_
+
+#include "symbol.h"
+
+using namespace std;
+
+class grammar {
+// FIRST and FOLLOW sets of the productions of lille, as given in Lille_Syntax.pdf, built at compile time.
+// The parser asks which production comes next by testing the current symbol against a FIRST set, and
+// error recovery skips to a symbol of a synchronisation set drawn from the FIRST and FOLLOW sets. Changing
+// the grammar means changing these tables.
+public:
+	// Groups of terminals.
+	static constexpr symbol_set relop = { symbol::equals_sym, symbol::not_equals_sym, symbol::less_than_sym,
+			symbol::greater_than_sym, symbol::less_or_equal_sym, symbol::greater_or_equal_sym };
+	static constexpr symbol_set addop = { symbol::plus_sym, symbol::minus_sym };
+	static constexpr symbol_set multop = { symbol::asterisk_sym, symbol::slash_sym };
+	static constexpr symbol_set number = { symbol::integer, symbol::real_num };
+	static constexpr symbol_set boolean = { symbol::true_sym, symbol::false_sym };
+	static constexpr symbol_set literal = number | boolean | symbol_set{ symbol::strng };
+
+	// FIRST sets.
+	static constexpr symbol_set first_type = { symbol::integer_sym, symbol::real_sym, symbol::string_sym,
+			symbol::boolean_sym };
+	static constexpr symbol_set first_param_kind = { symbol::value_sym, symbol::ref_sym };
+	static constexpr symbol_set first_primary = literal
+			| symbol_set{ symbol::not_sym, symbol::odd_sym, symbol::left_paren_sym, symbol::identifier };
+	static constexpr symbol_set first_factor = first_primary | addop;
+	static constexpr symbol_set first_expr = first_factor;
+	static constexpr symbol_set first_declaration = { symbol::identifier, symbol::procedure_sym,
+			symbol::function_sym };
+	static constexpr symbol_set first_block = first_declaration | symbol_set{ symbol::begin_sym };
+	static constexpr symbol_set first_simple_statement = { symbol::identifier, symbol::exit_sym,
+			symbol::return_sym, symbol::read_sym, symbol::write_sym, symbol::writeln_sym, symbol::null_sym };
+	static constexpr symbol_set first_compound_statement = { symbol::if_sym, symbol::loop_sym, symbol::for_sym,
+			symbol::while_sym };
+	static constexpr symbol_set first_statement = first_simple_statement | first_compound_statement;
+
+	// FOLLOW sets. Not, odd and unary operators put a whole <expr> inside a <primary>, so everything that can
+	// follow an operand can follow an expression too.
+	static constexpr symbol_set follow_prog = { symbol::end_of_program };
+	static constexpr symbol_set follow_block = { symbol::semicolon_sym };
+	static constexpr symbol_set follow_declaration = first_block;
+	static constexpr symbol_set follow_ident_list = { symbol::colon_sym };
+	static constexpr symbol_set follow_param_list = { symbol::right_paren_sym };
+	static constexpr symbol_set follow_type = { symbol::semicolon_sym, symbol::becomes_sym, symbol::is_sym,
+			symbol::right_paren_sym };
+	static constexpr symbol_set follow_statement_list = { symbol::end_sym, symbol::elsif_sym, symbol::else_sym };
+	static constexpr symbol_set follow_statement = { symbol::semicolon_sym };
+	static constexpr symbol_set follow_expr = relop | addop | multop
+			| symbol_set{ symbol::power_sym, symbol::and_sym, symbol::or_sym, symbol::ampersand_sym, symbol::in_sym,
+			symbol::range_sym, symbol::semicolon_sym, symbol::comma_sym, symbol::right_paren_sym, symbol::then_sym,
+			symbol::loop_sym };
+
+	// Synchronisation sets: where parsing picks up again after a syntax error, in the declarations of a block,
+	// its statements, and within one statement. Identifiers also start declarations and statements, but
+	// they are everywhere, so recovering at one would resume in the middle of the damage.
+	static constexpr symbol_set sync_declaration = { symbol::semicolon_sym, symbol::procedure_sym,
+			symbol::function_sym, symbol::begin_sym };
+	static constexpr symbol_set statement_keywords = { symbol::exit_sym, symbol::return_sym, symbol::read_sym,
+			symbol::write_sym, symbol::writeln_sym, symbol::null_sym, symbol::if_sym, symbol::loop_sym,
+			symbol::for_sym, symbol::while_sym };
+	static constexpr symbol_set sync_block = statement_keywords | symbol_set{ symbol::semicolon_sym, symbol::end_sym };
+	static constexpr symbol_set sync_statement = sync_block;
+
+	// Binding strength of the binary operators, one level for each of <expr>, <simple_expr>, <expr2>, <term>
+	// and <factor>, loosest first. Expressions are parsed by precedence climbing over these levels. A relational
+	// operator, IN or ** takes operands of the level above it, so a second one at the same level is not part
+	// of the expression.
+	static constexpr int relation_precedence = 1;		// relop and in
+	static constexpr int string_precedence = 2;			// &
+	static constexpr int adding_precedence = 3;			// + - or
+	static constexpr int multiplying_precedence = 4;	// * / and
+	static constexpr int power_precedence = 5;			// **
+
+	static constexpr int precedence(symbol::symbol_type s)
+	// The level of s, or 0 if it is not a binary operator.
+	{
+		switch (s)
+		{
+			case symbol::equals_sym:
+			case symbol::not_equals_sym:
+			case symbol::less_than_sym:
+			case symbol::greater_than_sym:
+			case symbol::less_or_equal_sym:
+			case symbol::greater_or_equal_sym:
+			case symbol::in_sym:
+				return relation_precedence;
+			case symbol::ampersand_sym:
+				return string_precedence;
+			case symbol::plus_sym:
+			case symbol::minus_sym:
+			case symbol::or_sym:
+				return adding_precedence;
+			case symbol::asterisk_sym:
+			case symbol::slash_sym:
+			case symbol::and_sym:
+				return multiplying_precedence;
+			case symbol::power_sym:
+				return power_precedence;
+			default:
+				return 0;
+		}
+	}
+
+	static constexpr bool associative(int level)
+	// Whether operators of the level can follow one another, grouping to the left.
+	{
+		return (level != relation_precedence) and (level != power_precedence);
+	}
+
+	// Symbols a statement list stops at. Any other symbol is parsed as a statement, even one that cannot start
+	// a statement, so the mistake is reported and skipped within the list rather than ending the block early.
+	static constexpr symbol_set end_statement_list = follow_statement_list | symbol_set{ symbol::end_of_program };
+};
+
+#endif /* GRAMMAR_H_ */
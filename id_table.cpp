@@ -7,60 +7,77 @@
 #include "id_table_entry.h"
 #include "lille_kind.h"
 #include "lille_type.h"
+#include "time_report.h"
 
 using namespace std;
 
 // Constructor for the id_table class
-id_table::id_table(error_handler* err) {
+id_table::id_table(error_handler* err, name_table* n) {
     // Initialize error handler and other variables
     error = err;
+    names = n;
     debug_mode = false;
     scope_level = 0;
 
-    // Initialize symbol table entries
-    for (int i = 0; i < max_depth; i++) {
-        sym_table[i] = new node;
-        sym_table[i]->idt = NULL;
-        sym_table[i]->left = NULL;
-        sym_table[i]->right = NULL;
-    }
+    // Scope 0 holds the program name and the predefined functions
+    scope_bindings.push_back(NULL);
+    scope_arenas.push_back(new arena());
+}
+
+// Destructor for the id_table class
+id_table::~id_table() {
+    // Close any scopes still open; scope 0 is released with its arena
+    while (scope() > 0)
+        exit_scope();
+    for (arena* a : scope_arenas)
+        delete a;
 }
 
 // Function to dump the id_table
 void id_table::dump_id_table(bool dump_all) {
-    node* ptr;
     if (!dump_all) {
         if (debug_mode) {
             cout << "Dump of idtable for current scope only." << endl;
             cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
         }
 
-        ptr = sym_table[scope()];
         exit_scope();
-        delete ptr;
-        ptr = NULL;
     } else {
         if (debug_mode) {
             cout << "Dump of the entire symbol table." << endl;
             cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
         }
 
-        while (scope() > 0) {
-            ptr = sym_table[scope()];
+        while (scope() > 0)
             exit_scope();
-            delete ptr;
-            ptr = NULL;
-        }
     }
 }
 
 // Function to enter a new scope
 void id_table::enter_scope() {
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    time_report::count(time_report::scopes_counter);
     scope_level++;
+    if (size_t(scope_level) == scope_bindings.size()) {
+        scope_bindings.push_back(NULL);
+        scope_arenas.push_back(new arena());
+    }
+    scope_bindings[scope_level] = NULL;
 }
 
 // Function to exit the current scope
 void id_table::exit_scope() {
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    if (scope_level == 0)
+        return;                 // the outermost scope lasts as long as the table
+
+    // Unbind everything declared in this scope, uncovering whatever it shadowed
+    for (binding* b = scope_bindings[scope_level]; b != NULL; b = b->next_in_scope)
+        visible[b->idt->name_id()] = b->shadowed;
+    scope_bindings[scope_level] = NULL;
+
+    // then free its bindings and entries wholesale
+    scope_arenas[scope_level]->release();
     scope_level--;
 }
 
@@ -71,32 +88,19 @@ int id_table::scope() {
 
 // Function to add a new entry to the symbol table
 void id_table::add_table_entry(id_table_entry* id) {
-    node* entry = new node;
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    int id_name = id->name_id();
+    if (id_name == name_table::no_name)
+        return;                 // nothing can ever look it up
+    if (size_t(id_name) >= visible.size())
+        visible.resize(names->size(), NULL);
+
+    binding* entry = scope_arenas[scope()]->make<binding>();
     entry->idt = id;
-    entry->right = NULL;
-    entry->left = NULL;
-
-    node* x = sym_table[scope()], * y = NULL;
-
-    // Find the correct position in the binary search tree
-    while (x->idt != NULL) {
-        y = x;
-        if (id->name() < x->idt->name()) {
-            x = x->left;
-        } else {
-            x = x->right;
-        }
-        if (x == NULL)
-            break;
-    }
-
-    // Insert the new entry
-    if (y == NULL)
-        sym_table[scope()] = entry;
-    else if (id->name() < y->idt->name())
-        y->left = entry;
-    else
-        y->right = entry;
+    entry->shadowed = visible[id_name];
+    entry->next_in_scope = scope_bindings[scope()];
+    visible[id_name] = entry;
+    scope_bindings[scope()] = entry;
 
     if (debug_mode)
         cout << "ADDED ENTRY: Created Entry " << id->name() << " in Scope " << scope() << endl;
@@ -104,60 +108,44 @@ void id_table::add_table_entry(id_table_entry* id) {
 
 // Function to create a new id_table_entry
 id_table_entry* id_table::enter_id(token* id, lille_type typ, lille_kind kind, int level, int offset, lille_type return_tipe) {
-    return new id_table_entry(id, typ, kind, level, offset, return_tipe);
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    return scope_arenas[scope()]->make<id_table_entry>(id, typ, kind, level, offset, return_tipe);
 }
 
-// Function to look up an entry in the symbol table by name
-id_table_entry* id_table::lookup(string s) {
-    int sc = scope();
-    node* ptr = sym_table[sc];
-    bool found = false;
-
-    while (sc >= 0) {
-        if (ptr == NULL or ptr->idt == NULL) {
-            if (sc > 0)
-                ptr = sym_table[--sc];
-            else
-                sc--;
-        } else if (s < ptr->idt->name()) {
-            ptr = ptr->left;
-        } else if (s > ptr->idt->name()) {
-            ptr = ptr->right;
-        } else if (s == ptr->idt->name()) {
-            if (debug_mode)
-                cout << "FOUND ENTRY: Found entry " << s << " of type " << ptr->idt->tipe().to_string() << endl;
-            return ptr->idt;
-        }
+// Function to create the id_table_entry for a formal parameter
+id_table_entry* id_table::enter_param(token* id, lille_type typ, lille_kind kind, int level, int offset) {
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    int owner_scope = (scope() > 0) ? scope() - 1 : 0;
+    return scope_arenas[owner_scope]->make<id_table_entry>(id, typ, kind, level, offset, lille_type::type_unknown);
+}
+
+// Function to look up an entry in the symbol table by name_table ID
+id_table_entry* id_table::lookup(int id) {
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    time_report::count(time_report::lookups_counter);
+    if (id >= 0 and size_t(id) < visible.size() and visible[id] != NULL) {
+        if (debug_mode)
+            cout << "FOUND ENTRY: Found entry " << names->name(id) << " of type " << visible[id]->idt->tipe().to_string() << endl;
+        return visible[id]->idt;
     }
     if (debug_mode)
-        cout << "DID NOT FIND: Failed to find entry " << s << endl;
+        cout << "DID NOT FIND: Failed to find entry " << (id == name_table::no_name ? "" : names->name(id)) << endl;
     return NULL;
 }
 
-// Function to look up an entry in the symbol table by token
-id_table_entry* id_table::lookup(token* tok) {
-    int sc = scope();
-    node* ptr = sym_table[sc];
-    bool found = false;
-
-    while (sc >= 0) {
-        if (ptr == NULL or ptr->idt == NULL) {
-            if (sc > 0)
-                ptr = sym_table[--sc];
-            else
-                sc--;
-        } else if (tok < ptr->idt->token_value()) {
-            ptr = ptr->left;
-        } else if (tok > ptr->idt->token_value()) {
-            ptr = ptr->right;
-        } else if (tok == ptr->idt->token_value()) {
-            if (debug_mode)
-                cout << "FOUND ENTRY: Found entry " << tok->to_string() << endl;
-            return ptr->idt;
-        }
+// Function to look up an entry in the symbol table by name
+id_table_entry* id_table::lookup(string s) {
+    time_report::phase_guard timing(time_report::symbol_table_phase);
+    int id = names->find(s);
+    if (id == name_table::no_name) {
+        if (debug_mode)
+            cout << "DID NOT FIND: Failed to find entry " << s << endl;
+        return NULL;
     }
-    if (debug_mode)
-        cout << "DID NOT FIND: Failed to find entry " << tok->to_string() << endl;
-    return NULL;
+    return lookup(id);
 }
 
+// Function to look up an entry in the symbol table by token
+id_table_entry* id_table::lookup(token* tok) {
+    return lookup(tok->get_name_id());
+}
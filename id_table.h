@@ -3,57 +3,68 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include "token.h"
 #include "error_handler.h"
 #include "id_table.h"
 #include "id_table_entry.h"
 #include "lille_type.h"
 #include "lille_kind.h"
+#include "name_table.h"
+#include "arena.h"
 
 using namespace std;
 
 class id_table {
 private:
     error_handler* error;
+    name_table* names;
     bool debug_mode;
     int scope_level;
-    // maximum depth of nesting permitted in source code.
-    static const int max_depth = 10;
-    struct node {
-        node* left;
-        node* right;
+    // One declaration of a name. Bindings of the same name form a shadow chain from the innermost
+    // scope outwards, and bindings declared in the same scope are chained so the scope can be popped.
+    struct binding {
         id_table_entry* idt;
+        binding* shadowed;          // binding of the same name in an enclosing scope, or NULL
+        binding* next_in_scope;     // binding declared before this one in the same scope, or NULL
     };
-    node* sym_table[max_depth];
-    void add_table_entry(id_table_entry* it, node* ptr);
-    void dump_tree(node* ptr);
+    vector<binding*> visible;                   // visible[id] is the innermost binding of name_table ID id, or NULL
+    vector<binding*> scope_bindings;            // most recent binding declared in each open scope; grows with the nesting
+    vector<arena*> scope_arenas;                // bindings and entries of each scope, released when it closes.
+                                                // Arenas are kept once made, so re-entering a depth reuses its memory.
 
 public:
     
-    id_table(error_handler* err);
-    // Constructor
+    id_table(error_handler* err, name_table* n);
+    // Constructor. N is the name table the scanner interns identifiers into.
+
+    ~id_table();
+    // Releases every entry still held by the table.
 
     void enter_scope();
-    // Increments Scope 
+    // Opens a new, empty scope. There is no limit on how deeply scopes may nest.
 
     void exit_scope();
-    // Decrement Scope
+    // Closes the current scope, unbinding everything declared in it and freeing its entries in one go.
+    // Cost is proportional to the number of entries declared in the scope.
 
     int scope();
     // Returns Current Scope Value
 
+    id_table_entry* lookup(int id);
+    // Returns the innermost visible entry with name_table ID id, or NULL. Constant time.
     id_table_entry* lookup(string s);
-    // Searchs Binary Tree for an item
+    // Returns the innermost visible entry named s, or NULL
     id_table_entry* lookup(token* tok);
-    // Searches a binary tree for a token
+    // Returns the innermost visible entry with the name held in tok, or NULL
 
     void trace_all(bool b);
-    // Traces the binary tree
+    // Traces the table
 
     bool trace_all();
 
     void add_table_entry(id_table_entry* id);
-    // Adds an item to the id_table
+    // Adds an item to the current scope, hiding any entry of the same name in an enclosing scope
 
     id_table_entry* enter_id(token* id,
         lille_type typ = lille_type::type_unknown,
@@ -61,7 +72,16 @@ public:
         int level = 0,
         int offset = 0,
         lille_type return_tipe = lille_type::type_unknown);
-    // Generates an id_table_entry item
+    // Generates an id_table_entry item. It belongs to the current scope and is freed when the scope closes.
+
+    id_table_entry* enter_param(token* id,
+        lille_type typ = lille_type::type_unknown,
+        lille_kind kind = lille_kind::unknown,
+        int level = 0,
+        int offset = 0);
+    // Generates the entry for a formal parameter. Parameters are bound in the scope of the procedure body,
+    // but the procedure entry in the enclosing scope keeps them in its parameter list for checking calls,
+    // so they are allocated in the enclosing scope and live as long as the procedure does.
     
     void dump_id_table(bool dump_all = true);
     // Dumps the id_table
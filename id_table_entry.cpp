@@ -16,14 +16,13 @@ id_table_entry::id_table_entry() {
     r_val_entry = 0.0;
     s_val_entry = "";
     b_val_entry = false;
-    p_list_entry = NULL;
-    n_par_entry = 0;
     r_ty_entry = lille_type::type_unknown;
 }
 
 // Parameterized constructor
 id_table_entry::id_table_entry(token* id, lille_type typ, lille_kind kind, int level, int offset, lille_type return_tipe) {
     // Initialize member variables with provided values
+    debug_mode = false;
     id_entry = id;
     typ_entry = typ;
     kind_entry = kind;
@@ -32,8 +31,6 @@ id_table_entry::id_table_entry(token* id, lille_type typ, lille_kind kind, int l
     r_ty_entry = return_tipe;
 
     // Initialize other member variables to default values
-    p_list_entry = NULL;
-    n_par_entry = 0;
     lev_entry = 0;
     offset_entry = 0;
     trace_entry = false;
@@ -82,6 +79,19 @@ string id_table_entry::name() {
     return "";
 }
 
+// Getter for the identifier's name_table ID
+int id_table_entry::name_id() {
+    switch (id_entry->get_sym()) {
+    case symbol::identifier:
+    case symbol::program_sym:
+    case symbol::procedure_sym:
+    case symbol::function_sym:
+        return id_entry->get_name_id();
+    default:
+        return name_table::no_name;
+    }
+}
+
 // Getter for integer value
 int id_table_entry::integer_value() {
     return i_val_entry;
@@ -109,20 +119,9 @@ lille_type id_table_entry::return_tipe() {
 
 // Method to add a parameter to the list
 void id_table_entry::add_param(id_table_entry* param_entry) {
-    bool finished = false;
-    id_table_entry* ptr = this;
-    while (!finished) {
-        if (ptr->p_list_entry == NULL) {
-            // If the current parameter list entry is NULL, link the new parameter and finish
-            ptr->p_list_entry = param_entry;
-            finished = true;
-            this->n_par_entry++;
-            if (debug_mode)
-                cout << "LINKED PARAM: Linked " << param_entry->name() << " to " << this->name() << endl;
-        }
-        else
-            ptr = ptr->p_list_entry;
-    }
+    p_list_entry.push_back(param_entry);
+    if (debug_mode)
+        cout << "LINKED PARAM: Linked " << param_entry->name() << " to " << this->name() << endl;
 }
 
 // Method to fix constant values
@@ -141,20 +140,14 @@ void id_table_entry::fix_return_type(lille_type ret_ty) {
 
 // Method to get the nth parameter
 id_table_entry* id_table_entry::nth_parameter(int n) {
-    id_table_entry* ptr = this;
-    for (int i = 0; i < n + 1; i++) {
-        if (ptr->p_list_entry != NULL) {
-            ptr = ptr->p_list_entry;
-        }
-    }
-    if (ptr == this)
+    if (n < 0 or size_t(n) >= p_list_entry.size())
         return NULL;
-    return ptr;
+    return p_list_entry[n];
 }
 
 // Method to get the number of parameters
 int id_table_entry::number_of_params() {
-    return n_par_entry;
+    return p_list_entry.size();
 }
 
 // Getter for trace flag
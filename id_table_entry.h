@@ -3,9 +3,11 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include "token.h"
 #include "lille_type.h"
 #include "lille_kind.h"
+#include "name_table.h"
 
 using namespace std;
 
@@ -24,8 +26,7 @@ private:
     float r_val_entry;         // Real value
     string s_val_entry;        // String value
     bool b_val_entry;          // Boolean value
-    id_table_entry* p_list_entry;  // Pointer to the list of parameters
-    int n_par_entry;           // Number of parameters
+    vector<id_table_entry*> p_list_entry;  // Formal parameters, in declaration order
     lille_type r_ty_entry;     // Return type for functions
 
 public:
@@ -66,6 +67,9 @@ public:
     // Getter for the identifier's name
     string name();
 
+    // Getter for the identifier's name_table ID
+    int name_id();
+
     // Getter for integer value
     int integer_value();
 
@@ -93,7 +97,7 @@ public:
     // Method to add a parameter to the list
     void add_param(id_table_entry* param_entry);
 
-    // Method to get the nth parameter
+    // Method to get the nth parameter, counting from 0, in constant time
     id_table_entry* nth_parameter(int n);
 
     // Method to get the number of parameters
@@ -0,0 +1,132 @@
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "name_table.h"
+#include "lille_exception.h"
+#include "time_report.h"
+
+using namespace std;
+
+thread_local name_table* name_table::active = NULL;
+
+
+name_table::name_table()
+{
+	name_starts.push_back(0);
+	slots.assign(1024, 0);			// Must be a power of 2.
+	active = this;
+}
+
+
+name_table::~name_table()
+{
+	if (active == this)
+		active = NULL;
+}
+
+
+uint32_t name_table::hash(const char* s, size_t length)
+// FNV-1a.
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		h ^= (unsigned char) s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+int name_table::probe(const char* s, size_t length, uint32_t h, size_t& slot)
+// Linear probing. Returns the ID found, or no_name with slot set to the empty slot where s belongs.
+{
+	size_t mask = slots.size() - 1;
+	int probes = 1;
+	slot = h & mask;
+	while (slots[slot] != 0)
+	{
+		int id = slots[slot] - 1;
+		if ((name_hashes[id] == h)
+				and (name_starts[id + 1] - name_starts[id] == length)
+				and (memcmp(name_chars.data() + name_starts[id], s, length) == 0))
+		{
+			time_report::count(time_report::probes_counter, probes);
+			return id;
+		}
+		slot = (slot + 1) & mask;
+		probes++;
+	}
+	time_report::count(time_report::probes_counter, probes);
+	return no_name;
+}
+
+
+void name_table::grow()
+{
+	slots.assign(slots.size() * 2, 0);
+	size_t mask = slots.size() - 1;
+	for (size_t id = 0; id < name_hashes.size(); id++)
+	{
+		size_t slot = name_hashes[id] & mask;
+		while (slots[slot] != 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = id + 1;
+	}
+}
+
+
+int name_table::intern(const char* s, size_t length)
+{
+	uint32_t h = hash(s, length);
+	size_t slot;
+	int id = probe(s, length, h, slot);
+	if (id != no_name)
+		return id;
+
+	id = name_hashes.size();
+	name_chars.insert(name_chars.end(), s, s + length);
+	name_starts.push_back(name_chars.size());
+	name_hashes.push_back(h);
+	slots[slot] = id + 1;
+	time_report::count(time_report::names_counter);
+	if (name_hashes.size() * 2 > slots.size())		// keep the load factor at or below one half
+		grow();
+	return id;
+}
+
+
+int name_table::intern(string s)
+{
+	return intern(s.data(), s.length());
+}
+
+
+int name_table::find(string s)
+{
+	size_t slot;
+	return probe(s.data(), s.length(), hash(s.data(), s.length()), slot);
+}
+
+
+string name_table::name(int id)
+{
+	if ((id < 0) or (id >= size()))
+		throw lille_exception("Illegal name id in name_table.");
+	return string(name_chars.data() + name_starts[id], name_chars.data() + name_starts[id + 1]);
+}
+
+
+int name_table::size()
+{
+	return name_hashes.size();
+}
+
+
+name_table* name_table::current()
+{
+	if (active == NULL)
+		throw lille_exception("No name_table exists for identifier names.");
+	return active;
+}
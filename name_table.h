@@ -0,0 +1,52 @@
+#ifndef NAME_TABLE_H_
+#define NAME_TABLE_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+class name_table {
+private:
+	vector<char> name_chars;			// Text of every name, stored back to back.
+	vector<uint32_t> name_starts;		// name_starts[id] is where name id begins in name_chars; it ends at name_starts[id + 1].
+	vector<uint32_t> name_hashes;		// Hash of each name, kept so the slots can be rebuilt without rehashing the text.
+	vector<uint32_t> slots;				// Open addressing hash table. Holds id + 1, or 0 for an empty slot.
+
+	static thread_local name_table* active;	// Table used to resolve the names held in tokens. One per thread, so
+										// threads lexing parts of a source can each intern into their own.
+
+	static uint32_t hash(const char* s, size_t length);
+	int probe(const char* s, size_t length, uint32_t h, size_t& slot);	// Find s, or the empty slot where it belongs.
+	void grow();														// Double the number of slots.
+
+public:
+	static const int no_name = -1;		// ID returned by find() for a name that was never interned.
+
+	name_table();
+	// Creates an empty table for one compilation and makes it the table tokens use to resolve names.
+
+	~name_table();
+
+	int intern(const char* s, size_t length);
+	// Returns the ID of the name held in the length characters at s, adding it if it is new.
+	// IDs are dense: the first distinct name is 0, the next 1, and so on. The name must already be in
+	// upper case; interning is exact.
+
+	int intern(string s);
+
+	int find(string s);
+	// Returns the ID of s, or no_name if s has never been interned.
+
+	string name(int id);
+	// Returns the text of name id.
+
+	int size();
+	// Number of distinct names interned.
+
+	static name_table* current();
+	// The name table of the compilation in progress.
+};
+
+#endif /* NAME_TABLE_H_ */
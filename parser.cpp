@@ -6,6 +6,7 @@
 #include "scanner.h"
 #include "token.h"
 #include "parser.h"
+#include "grammar.h"
 #include "lille_type.h"
 #include "lille_kind.h"
 #include "id_table.h"
@@ -21,6 +22,11 @@ parser::parser(scanner* s, id_table* t, error_handler* e) {
     current_entry = NULL;
     current_fun_or_proc = NULL;
     current_ident = NULL;
+    nesting_depth = 0;
+    statement_depth = 0;
+    expression_depth = 0;
+
+    tree = new ast();
 }
 
 parser::~parser() {
@@ -33,47 +39,65 @@ parser::~parser() {
     delete error;
     error = NULL;
 
-    delete current_entry;
-    current_entry = NULL;
+    delete tree;
+    tree = NULL;
 
-    delete current_fun_or_proc ;
+    // The entries themselves belong to the id_table
+    current_entry = NULL;
     current_fun_or_proc = NULL;
-
-    delete current_ident;
     current_ident = NULL;
 }
 
 void parser::define_function(string name, lille_type t, lille_type p) {
     // Create variables 
     token* fun, * arg;
-    symbol* sym;
+    symbol sym;
     id_table_entry* fun_id, * param_id;
     // Generate the entry
-    sym = new symbol(symbol::identifier);
-    fun = new token(sym, 0, 0);
+    sym = symbol(symbol::identifier);
+    fun = new token(sym);
     fun->set_identifier_value(name);
     fun_id = table->enter_id(fun, lille_type::type_func, lille_kind::unknown, 0, 0, t);
     table->add_table_entry(fun_id);
 
     // Generate the Arguments
-    arg = new token(sym, 0, 0);
+    arg = new token(sym);
     arg->set_identifier_value("__" + name + "_arg__"); // predefined functions have one arg
                                                        // that is `__NAME__arg_`
-    param_id = new id_table_entry(arg, p, lille_kind::value_param, 0, 0, lille_type::type_unknown);
+    param_id = table->enter_param(arg, p, lille_kind::value_param, 0, 0);
     fun_id->add_param(param_id);
 }
 
-void parser::PROG() { // Begin program
+ast* parser::syntax_tree() {
+    return tree;
+}
+
+void parser::restart(id_table* t) {
+    delete table;
+    table = t;
+    tree->release();
+
+    current_entry = NULL;
+    current_fun_or_proc = NULL;
+    current_ident = NULL;
+    nesting_depth = 0;
+    statement_depth = 0;
+    expression_depth = 0;
+}
+
+ast::node_id parser::PROG() { // Begin program
 
+    uint32_t at = scan->this_offset();
     scan->must_be(symbol::program_sym); 
 
     // Add the program call to the id table
-    symbol* sym = new symbol(symbol::program_sym);
-    token* prog = new token(sym, 0, 0);
-    prog->set_prog_value(scan->get_current_identifier_name());
+    symbol sym = symbol(symbol::program_sym);
+    token* prog = new token(sym);
+    prog->set_name_id(declared_name());
     id_table_entry* prog_id = table->enter_id(prog, lille_type::type_prog, lille_kind::unknown, table->scope(), 0, lille_type::type_unknown);
     table->add_table_entry(prog_id);
     current_entry = prog_id;
+    ast::node_id prog_node = tree->add(ast::program_node, at, lille_type::type_prog, prog->get_name_id());
 
     scan->must_be(symbol::identifier);
 
@@ -86,33 +110,44 @@ void parser::PROG() { // Begin program
     scan->must_be(symbol::is_sym);
 
     // Begin parsing through block
-    BLOCK();
+    tree->add_child(prog_node, BLOCK());
 
     scan->must_be(symbol::semicolon_sym);
     table->dump_id_table(true);
+    return prog_node;
 }
 
-void parser::BLOCK() {
+ast::node_id parser::BLOCK() {
 
     // Enter a new scope
     table->enter_scope();
+    ast::node_id block = tree->add(ast::block_node, scan->this_offset());
 
     // Find all variable declerations, as well as
     // all function and procedure definitions
-    while (IS_DECLERATION()) 
-         DECLERATION();
+    {
+        scanner::sync_guard sync(scan, grammar::sync_declaration);
+        while (IS_DECLERATION()) 
+             tree->add_child(block, DECLERATION());
 
-    scan->must_be(symbol::begin_sym);
-    STATEMENT_LIST();
+        scan->must_be(symbol::begin_sym);
+    }
+    scanner::sync_guard sync(scan, grammar::sync_block);
+    tree->add_child(block, STATEMENT_LIST());
     scan->must_be(symbol::end_sym);
     if (scan->have(symbol::identifier)) {
 
         scan->must_be(symbol::identifier);
     }
     table->exit_scope();
+    return block;
 }
 
-void parser::DECLERATION() { 
+ast::node_id parser::DECLERATION() { 
+    scanner::sync_guard sync(scan, grammar::sync_declaration);
+    error->settled(scan->this_offset());    // errors are flagged in the declaration or statement being parsed
+    ast::node_id decl;
+    uint32_t at = scan->this_offset();
 
     // If declaring identifier ->
     if (scan->have(symbol::identifier)) {
@@ -151,11 +186,16 @@ void parser::DECLERATION() {
         string s_value;
         bool b_value; 
 
+        decl = tree->add(ast::variable_node, at, ty, 0, const_flag ? lille_kind::constant : lille_kind::variable);
+        for(token* v : variables)
+            tree->add_child(decl, tree->add(ast::identifier_node, v->get_offset(), ty, v->get_name_id()));
+
         // If was const, find the const value ->
         if(const_flag) {
             scan->must_be(symbol::becomes_sym);
+            tree->add_child(decl, make_literal());
             // Find what type the value is ->
-            int sym = scan->this_token()->get_symbol()->get_sym();
+            int sym = scan->this_token()->get_symbol().get_sym();
             switch(sym) {
                 case symbol::real_num: {
                     r_value = scan->this_token()->get_real_value();
@@ -210,17 +250,19 @@ void parser::DECLERATION() {
     // Else is a procedure/function decleration ->
     else {
         bool is_func = false;
+        id_table_entry* enclosing = current_fun_or_proc;
         // Is a prcedure ->
         if(scan->have(symbol::procedure_sym)) {
             scan->must_be(symbol::procedure_sym);
 
             // Add the procedure to the id table
-            symbol* sym = new symbol(symbol::procedure_sym);
-            token* proc = new token(sym, 0, 0);
-            proc->set_proc_value(scan->get_current_identifier_name());
+            symbol sym = symbol(symbol::procedure_sym);
+            token* proc = new token(sym);
+            proc->set_name_id(declared_name());
             id_table_entry* proc_id = table->enter_id(proc, lille_type::type_proc, lille_kind::unknown, table->scope(), 0, lille_type::type_unknown);
             table->add_table_entry(proc_id);
             current_fun_or_proc = proc_id;
+            decl = tree->add(ast::procedure_node, at, lille_type::type_unknown, proc->get_name_id());
 
             scan->must_be(symbol::identifier);
         }
@@ -229,12 +271,13 @@ void parser::DECLERATION() {
             scan->must_be(symbol::function_sym);
 
             // Add the function to the id table
-            symbol* sym = new symbol(symbol::function_sym);
-            token* fun = new token(sym, 0, 0);
-            fun->set_fun_value(scan->get_current_identifier_name());
+            symbol sym = symbol(symbol::function_sym);
+            token* fun = new token(sym);
+            fun->set_name_id(declared_name());
             id_table_entry* fun_id = table->enter_id(fun, lille_type::type_func, lille_kind::unknown, table->scope(), 0, lille_type::type_unknown);
             table->add_table_entry(fun_id);
             current_fun_or_proc = fun_id;
+            decl = tree->add(ast::function_node, at, lille_type::type_unknown, fun->get_name_id());
 
             scan->must_be(symbol::identifier);
 
@@ -242,13 +285,20 @@ void parser::DECLERATION() {
             is_func = true;
         }
         
+        // Stop before a pathologically deep nest can exhaust the native stack
+        if (++nesting_depth > max_nesting) {
+            error->flag(scan->this_token(), 125);
+            throw lille_exception("Procedures and functions nested more than " + to_string(max_nesting) + " deep.");
+        }
+
         table->enter_scope();
-        PARAM();
+        PARAM(decl);
 
         // If is a function ->
         if(is_func) {
             scan->must_be(symbol::return_sym);
             current_fun_or_proc->fix_return_type(get_ident_type());
+            (*tree)[decl].type = get_ident_type().get_type();
              if (scan->have(symbol::integer_sym)) 
                 scan->must_be(symbol::integer_sym);
             else if (scan->have(symbol::real_sym)) 
@@ -261,78 +311,84 @@ void parser::DECLERATION() {
 
         // Continue into the body of the procedure/function
         scan->must_be(symbol::is_sym);
-        BLOCK();
+        tree->add_child(decl, BLOCK());
         scan->must_be(symbol::semicolon_sym);
         current_entry = NULL;
-        current_fun_or_proc = NULL;
+        current_fun_or_proc = enclosing;   // back in the body of the enclosing function, if any
         table->exit_scope();
+        nesting_depth--;
     }
+    return decl;
 }
 
-void parser::STATEMENT_LIST() {
+ast::node_id parser::STATEMENT_LIST() {
 
-    STATEMENT();
+    ast::node_id list = tree->add(ast::statement_list_node, scan->this_offset());
+    tree->add_child(list, STATEMENT());
     scan->must_be(symbol::semicolon_sym);
-    while (IS_STATEMENT()) {
-        STATEMENT();
+    while (not scan->have(grammar::end_statement_list)) {
+        tree->add_child(list, STATEMENT());
         scan->must_be(symbol::semicolon_sym);
     }
-    
+    return list;
 }
 
-void parser::STATEMENT() {
+ast::node_id parser::STATEMENT() {
+    scanner::sync_guard sync(scan, grammar::sync_statement);
+    error->settled(scan->this_offset());
 
-    if (scan->have(symbol::if_sym) or scan->have(symbol::while_sym) or scan->have(symbol::for_sym) or scan->have(symbol::loop_sym)) 
-        COMPOUND_STATEMENT();
+    if (scan->have(grammar::first_compound_statement)) 
+        return COMPOUND_STATEMENT();
     else 
-        SIMPLE_STATEMENT();
+        return SIMPLE_STATEMENT();
     
 }
 
-void parser::COMPOUND_STATEMENT() {
+ast::node_id parser::COMPOUND_STATEMENT() {
+    // Each IF, LOOP, FOR and WHILE holds a statement list of its own, a level deeper on the stack
+    if (++statement_depth > max_nesting) {
+        error->flag(scan->this_token(), 125);
+        throw lille_exception("Statements nested more than " + to_string(max_nesting) + " deep.");
+    }
 
+    ast::node_id statement;
     if (scan->have(symbol::if_sym)) 
-        IF_STATEMENT();
+        statement = IF_STATEMENT();
     else if (scan->have(symbol::loop_sym)) 
-        LOOP_STATEMENT();
+        statement = LOOP_STATEMENT();
     else if (scan->have(symbol::for_sym)) 
-        FOR_STATEMENT();
-    else if (scan->have(symbol::while_sym)) 
-        WHILE_STATEMENT();
+        statement = FOR_STATEMENT();
+    else
+        statement = WHILE_STATEMENT();
+    statement_depth--;
+    return statement;
 }
 
-void parser::SIMPLE_STATEMENT() {
+ast::node_id parser::SIMPLE_STATEMENT() {
+    uint32_t at = scan->this_offset();
+    ast::node_id statement;
     if (scan->have(symbol::identifier)) {
         // Lookup the identifier
-        string current_entry_name = scan->get_current_identifier_name();
-        current_entry = table->lookup(current_entry_name);
-
-        if(current_entry == NULL) {
-            error->flag(scan->this_token(), 81);
-            throw lille_exception("Identifier not previously declared.");
-        }
-
-        else if(current_entry->tipe().is_type(lille_type::type_prog)) {
+        current_entry = lookup_ident();
+        if(current_entry->tipe().is_type(lille_type::type_prog)) {
             error->flag(scan->this_token(), 91);
         }
 
+        ast::node_id assigned = make_identifier(current_entry);
         scan->must_be(symbol::identifier);
         
         // If a left parantheses is found, handle 
         // function or procedure ->
-        if(current_entry->tipe().is_type(lille_type::type_func) or current_entry->tipe().is_type(lille_type::type_proc)) {
-            handle_function_or_procedure_call(current_entry);
+        // An undeclared name is taken for a call unless it is being assigned to
+        bool undeclared = current_entry->tipe().is_type(lille_type::type_unknown);
+        if(current_entry->tipe().is_type(lille_type::type_func) or current_entry->tipe().is_type(lille_type::type_proc)
+                or (undeclared and not scan->have(symbol::becomes_sym))) {
+            statement = handle_function_or_procedure_call(current_entry, at);
         }
         // If not a function/procedure call, must be becomes
         else {
             scan->must_be(symbol::becomes_sym);
             /**** HANDLE BECOMES ****/
-            bool finished = true;
-
-            if(current_entry == NULL) {
-                error->flag(scan->this_token(), 81);
-            }
-            
             if(current_entry->kind().is_kind(lille_kind::for_ident))
                 error->flag(scan->this_token(), 85);
 
@@ -340,226 +396,50 @@ void parser::SIMPLE_STATEMENT() {
                 error->flag(scan->this_token(), 85);
             }
 
-            do {
-                // If wrapped in paren, eat the symbols
-                if(scan->have(symbol::left_paren_sym)) {
-                    scan->must_be(symbol::left_paren_sym);
-                    finished = false;
-                }
-                else if(scan->have(symbol::right_paren_sym)) {
-                    scan->must_be(symbol::right_paren_sym);
-                    finished = false;
-                }
+            lille_type target = current_entry->tipe();
+            if(target.is_type(lille_type::type_prog))
+                target = lille_type::type_unknown;
 
-                // If a not, check if value is boolean
-                else if(scan->have(symbol::not_sym)) {
-                    if(not current_entry->tipe().is_type(lille_type::type_boolean))
-                        throw lille_exception("Cannot use operator 'not' in a non-boolean ");
-                    scan->must_be(symbol::not_sym);
-                    finished = false;
-                }
-                else if(scan->have(symbol::identifier)) {
-                    current_ident = table->lookup(scan->get_current_identifier_name());
-                    if(not current_entry->tipe().is_type(current_ident->tipe()))
-                        error->flag(scan->this_token(), 121);
-                    scan->must_be(symbol::identifier);
-
-                    /**** HANDLE FUNCTION/PROCEDURE CALL ****/
-                    if(current_ident->tipe().is_type(lille_type::type_func) or current_ident->tipe().is_type(lille_type::type_proc)) {
-                        if(current_ident->tipe().is_type(lille_type::type_func) or current_ident->tipe().is_type(lille_type::type_proc))
-                            handle_function_or_procedure_call(current_ident);
-                        else
-                            error->flag(scan->this_token(), 121);
-                    }
-                    finished = false;
-                }
-                // If is a number ->
-                else if(IS_NUMBER()) {
-                    // Make sure variable is the same type
-                    lille_type ty;
-                    if(scan->have(symbol::integer))
-                        ty = lille_type::type_integer;
-                    else
-                        ty = lille_type::type_real;
-                    if(not current_entry->tipe().is_type(ty)) 
-                        throw lille_exception("Value given does not match the type of " + current_entry_name);
-                    if(scan->have(symbol::integer)) {
-                        scan->must_be(symbol::integer);
-                    }
-                    else if(scan->have(symbol::real_num)) {
-                        scan->must_be(symbol::real_num);
-                    }
-                    finished = false;
-                }
-                // If is a mathmatical operation 
-                else if(IS_ADDOP()) {
-                    if (scan->have(symbol::plus_sym)) 
-                        scan->must_be(symbol::plus_sym);
-                    else 
-                        scan->must_be(symbol::minus_sym);
-                    // Check if variable is of number type
-                    if(not current_entry->tipe().is_type(lille_type::type_integer) and not current_entry->tipe().is_type(lille_type::type_real))
-                        throw lille_exception("Cannot add or subtract non-numbers");
-                    finished = false;
-                }
-                else if(IS_MULTOP()) {
-                    if (scan->have(symbol::asterisk_sym)) 
-                        scan->must_be(symbol::asterisk_sym);
-                    else 
-                        scan->must_be(symbol::slash_sym);
-                    if(not current_entry->tipe().is_type(lille_type::type_integer) and not current_entry->tipe().is_type(lille_type::type_real))
-                        throw lille_exception("Cannot multiply or divide non-numbers");
-                    finished = false;
-                }
-                // If is a boolean comparison
-                else if(IS_RELOP()) {
-                    if (scan->have(symbol::greater_than_sym)) 
-                        scan->must_be(symbol::greater_than_sym);
-                    else if (scan->have(symbol::less_than_sym)) 
-                        scan->must_be(symbol::less_than_sym);
-                    else if (scan->have(symbol::equals_sym)) 
-                        scan->must_be(symbol::equals_sym);
-                    else if (scan->have(symbol::not_equals_sym)) 
-                        scan->must_be(symbol::not_equals_sym);
-                    else if (scan->have(symbol::less_or_equal_sym)) 
-                        scan->must_be(symbol::less_or_equal_sym);
-                    else  if (scan->have(symbol::greater_or_equal_sym))
-                        scan->must_be(symbol::greater_or_equal_sym);
-                    else
-                        throw lille_exception("Expected a logical symbol (> < <> = >= <=)");
-                    // Check if variable is of boolean type
-                    if(not current_entry->tipe().is_type(lille_type::type_boolean))
-                        throw lille_exception("Cannot compare non-boolean values");
-                    finished = false;
-                }
-                else if(IS_BOOL()) {
-                    if(not current_entry->tipe().is_type(lille_type::type_boolean))
-                        throw lille_exception("Cannot assign boolean values to a non boolean identifier");
-                    finished = false;
-                    if(scan->have(symbol::true_sym))
-                        scan->must_be(symbol::true_sym);
-                    else if(scan->have(symbol::false_sym))
-                        scan->must_be(symbol::false_sym);
-                    else
-                        throw lille_exception("Expected a boolean value");
-                }
-                else if(scan->have(symbol::strng)) {
-                    if(not current_entry->tipe().is_type(lille_type::type_string))
-                        throw lille_exception("Cannot assign string values to a non string identifier");
-                    finished = false;
-                    scan->must_be(symbol::strng);
-                }
-                else {
-                    finished = true;
-                }
-                
-            }
-            while(not finished);
+            statement = tree->add(ast::assign_node, at);
+            tree->add_child(statement, assigned);
+            ast::node_id value = EXPR(grammar::relation_precedence);
+            tree->add_child(statement, value);
+            if(not assignable(target, type_of(value)))
+                flag(value, 93);
         }
     } 
 
     // If exit sym is found ->
     else if (scan->have(symbol::exit_sym)) {
+        statement = tree->add(ast::exit_node, at);
         scan->must_be(symbol::exit_sym);
         if (scan->have(symbol::when_sym)) {
             scan->must_be(symbol::when_sym);
-            // Make sure indent given is an integer
-            current_ident = table->lookup(scan->get_current_identifier_name());
-            if(not current_ident->tipe().is_type(lille_type::type_integer))
-                throw lille_exception("Exit condition must be of Integer type");
-            scan->must_be(symbol::identifier);
-            if (scan->have(symbol::greater_than_sym)) 
-                scan->must_be(symbol::greater_than_sym);
-            else if (scan->have(symbol::less_than_sym)) 
-                scan->must_be(symbol::less_than_sym);
-            else if (scan->have(symbol::equals_sym)) 
-                scan->must_be(symbol::equals_sym);
-            else if (scan->have(symbol::not_equals_sym)) 
-                scan->must_be(symbol::not_equals_sym);
-            else if (scan->have(symbol::less_or_equal_sym)) 
-                scan->must_be(symbol::less_or_equal_sym);
-            else  if (scan->have(symbol::greater_or_equal_sym))
-                scan->must_be(symbol::greater_or_equal_sym);
-            else
-                throw lille_exception("Expected a logical symbol (> < <> = >= <=)");
-            // Make sure next ident is also an integer
-            if(scan->have(symbol::identifier)) {
-                current_ident = table->lookup(scan->get_current_identifier_name());
-                if(not current_ident->tipe().is_type(lille_type::type_integer))
-                    throw lille_exception("Exit condition must be of Integer type");
-                scan->must_be(symbol::identifier);
-            }
-            else {
-                // else make sure an integer is given
-                scan->must_be(symbol::integer);
-            }
+            tree->add_child(statement, handle_condition());
         }
     } 
     // If a return sym is found ->
     else if (scan->have(symbol::return_sym)) {
+        statement = tree->add(ast::return_node, at);
+        bool in_main_program = (current_fun_or_proc == NULL);
+        if(in_main_program)
+            error->flag(scan->this_token(), 88);
         scan->must_be(symbol::return_sym);
-        while (IS_EXPR() or IS_ADDOP() or IS_MULTOP()) {
-            // Make sure the identifier given is the functions return type
-            if(scan->have(symbol::identifier)) {
-                id_table_entry* current_return_ident = table->lookup(scan->get_current_identifier_name());
+        if (IS_EXPR()) {
+            ast::node_id value = EXPR(grammar::relation_precedence);
+            tree->add_child(statement, value);
+            if(not in_main_program) {
                 if(not current_fun_or_proc->tipe().is_type(lille_type::type_func))
-                    throw lille_exception("Return in non-function");
-                else if(current_return_ident->tipe().is_equal(lille_type::type_func)) {
-                    if(not current_fun_or_proc->return_tipe().is_type(current_return_ident->return_tipe()))
-                        throw lille_exception("ERROR: Function return value is " + current_fun_or_proc->return_tipe().to_string() + " but given " + current_return_ident->tipe().to_string());
-                }
-                else if(not current_fun_or_proc->return_tipe().is_type(current_return_ident->tipe()))
-                        throw lille_exception("Function return value is " + current_fun_or_proc->return_tipe().to_string() + " but given " + current_return_ident->tipe().to_string());
-                scan->must_be(symbol::identifier);
-            }
-            // Else if a number given is of functions return type
-            else if(IS_NUMBER()) {
-                if(scan->have(symbol::integer)) {
-                    if(not current_fun_or_proc->return_tipe().is_type(lille_type::type_integer))
-                        throw lille_exception("Function return value is " + current_fun_or_proc->tipe().to_string() + " but given Integer");
-                    scan->must_be(symbol::integer);
-                }
-                if(scan->have(symbol::real_num)) {
-                    if(not current_fun_or_proc->return_tipe().is_type(lille_type::type_integer))
-                        throw lille_exception("Function return value is " + current_fun_or_proc->tipe().to_string() + " but given Real Number");
-                    scan->must_be(symbol::real_num);
-                }
-            }
-            // Else if a boolean given is of functions return type
-            else if(IS_BOOL()) {
-                if(scan->have(symbol::true_sym)) 
-                    scan->must_be(symbol::true_sym);
-                else if(scan->have(symbol::false_sym)) 
-                    scan->must_be(symbol::false_sym);
-                if(not current_fun_or_proc->tipe().is_type(lille_type::type_integer))
-                        throw lille_exception("Function return value is " + current_fun_or_proc->tipe().to_string() + " but given Boolean");
-                    
-            }
-            // Else if a string given is of functions return type
-            else if(scan->have(symbol::strng)) {
-                if(not current_fun_or_proc->tipe().is_type(lille_type::type_integer))
-                        throw lille_exception("Function return value is " + current_fun_or_proc->tipe().to_string() + " but given String");
-                scan->must_be(symbol::strng);
+                    flag(value, 87);    // a procedure returns no value
+                else if(not assignable(current_fun_or_proc->return_tipe(), type_of(value)))
+                    flag(value, 87);
             }
-            else throw lille_exception("Function return is " + current_fun_or_proc->tipe().to_string() + " but given Unknown");
-        
-            if(IS_ADDOP()) {
-                    if (scan->have(symbol::plus_sym)) 
-                        scan->must_be(symbol::plus_sym);
-                    else 
-                        scan->must_be(symbol::minus_sym);
-                }
-                else if(IS_MULTOP()) {
-                    if (scan->have(symbol::asterisk_sym)) 
-                        scan->must_be(symbol::asterisk_sym);
-                    else 
-                        scan->must_be(symbol::slash_sym);
-                }
         }
     } 
 
     // If a read sym is found ->
     else if (scan->have(symbol::read_sym)) {
+        statement = tree->add(ast::read_node, at);
         scan->must_be(symbol::read_sym);
         bool lp = false, comma_sym = false;
         // Could have a parentheses wrapped around the call, if so eat the symbols
@@ -569,9 +449,8 @@ void parser::SIMPLE_STATEMENT() {
         }
         // Find if variables given in function exist
         do {
-            current_ident = table->lookup(scan->get_current_identifier_name());
-            if(current_ident == NULL)
-                throw lille_exception("Undeclared Variable " + scan->get_current_identifier_name());
+            current_ident = lookup_ident();
+            tree->add_child(statement, make_identifier(current_ident));
             scan->must_be(symbol::identifier);
             if(scan->have(symbol::comma_sym)) {
                 comma_sym = true;
@@ -586,188 +465,135 @@ void parser::SIMPLE_STATEMENT() {
         }
     } 
 
-    // If write sym is found ->
-    else if (scan->have(symbol::write_sym)) {
-        scan->must_be(symbol::write_sym);
-        bool lp = false, amp_sym = false;
-        // Could have a parentheses wrapped around the call, if so eat the symbols
-        if (scan->have(symbol::left_paren_sym)) {
-            scan->must_be(symbol::left_paren_sym);
-            lp = true;
+    // If write or writeln sym is found ->
+    else if (scan->have(symbol::write_sym) or scan->have(symbol::writeln_sym)) {
+        if (scan->have(symbol::write_sym)) {
+            statement = tree->add(ast::write_node, at);
+            scan->must_be(symbol::write_sym);
         }
-        // Register the entire string, accounting for `&`s and `,`s
-        do {
-            if(scan->have(symbol::identifier)) {
-                current_ident = table->lookup(scan->get_current_identifier_name());
-                scan->must_be(symbol::identifier);
-                if(current_ident->tipe().is_type(lille_type::type_func) or current_ident->tipe().is_type(lille_type::type_proc))
-                    handle_function_or_procedure_call(current_ident);
-            }
-            else if(scan->have(symbol::strng)) {
-                scan->must_be(symbol::strng);
-            }
-            if(scan->have(symbol::ampersand_sym)) {
-                scan->must_be(symbol::ampersand_sym);
-                amp_sym = true;
-            }   
-            else if(scan->have(symbol::comma_sym)) {
-                scan->must_be(symbol::comma_sym);
-                amp_sym = true;
-            }
-            else amp_sym = false;
+        else {
+            statement = tree->add(ast::writeln_node, at);
+            scan->must_be(symbol::writeln_sym);
         }
-        while(amp_sym);
-        if (lp) {
-            scan->must_be(symbol::right_paren_sym);
-        } 
-    }
-
-    // If writeln sym is found ->
-    else if (scan->have(symbol::writeln_sym)) {
-        scan->must_be(symbol::writeln_sym);
-        bool lp = false, amp_sym = false;
+        bool lp = false;
         // Could have a parentheses wrapped around the call, if so eat the symbols
         if (scan->have(symbol::left_paren_sym)) {
             scan->must_be(symbol::left_paren_sym);
             lp = true;
         }
-        // Same as write, register the entire string, accounting for `&`s and `,`s
-        do {
-            if(scan->have(symbol::identifier)) {
-                current_ident = table->lookup(scan->get_current_identifier_name());
-                scan->must_be(symbol::identifier);
-                if(current_ident->tipe().is_type(lille_type::type_func) or current_ident->tipe().is_type(lille_type::type_proc))
-                    handle_function_or_procedure_call(current_ident);
-                
-            }
-            else if(scan->have(symbol::strng)) {
-                scan->must_be(symbol::strng);
-            }
-            if(scan->have(symbol::ampersand_sym)) {
-                scan->must_be(symbol::ampersand_sym);
-                amp_sym = true;
-            }   
-            else if(scan->have(symbol::comma_sym)) {
+        // Each item between commas is an expression, which must be a number or a string. Writeln needs none.
+        if ((*tree)[statement].kind == ast::write_node or IS_EXPR()) {
+            ast::node_id item = EXPR(grammar::relation_precedence);
+            tree->add_child(statement, item);
+            operand_type(item, lille_type::type_arith_or_string, 84);
+            while (scan->have(symbol::comma_sym)) {
                 scan->must_be(symbol::comma_sym);
-                amp_sym = true;
+                item = EXPR(grammar::relation_precedence);
+                tree->add_child(statement, item);
+                operand_type(item, lille_type::type_arith_or_string, 84);
             }
-            else amp_sym = false;
         }
-        while(amp_sym);
         if (lp) {
             scan->must_be(symbol::right_paren_sym);
-        }
-    } 
+        } 
+    }
     else {
+        statement = tree->add(ast::null_node, at);
         scan->must_be(symbol::null_sym);
     }
     current_entry = NULL;
+    return statement;
 }
 
-void parser::IF_STATEMENT() {
+ast::node_id parser::IF_STATEMENT() {
+    ast::node_id statement = tree->add(ast::if_node, scan->this_offset());
     scan->must_be(symbol::if_sym);
-    handle_if_and_while();
+    tree->add_child(statement, handle_condition());
     scan->must_be(symbol::then_sym);
-    STATEMENT_LIST();
+    tree->add_child(statement, STATEMENT_LIST());
     while (scan->have(symbol::elsif_sym)) {
         scan->must_be(symbol::elsif_sym);
-        handle_if_and_while();
+        tree->add_child(statement, handle_condition());
         scan->must_be(symbol::then_sym);
-        STATEMENT_LIST();
+        tree->add_child(statement, STATEMENT_LIST());
     }
     if (scan->have(symbol::else_sym)) {
         scan->must_be(symbol::else_sym);
-        STATEMENT_LIST();
+        tree->add_child(statement, STATEMENT_LIST());
     }
     scan->must_be(symbol::end_sym);
     scan->must_be(symbol::if_sym);
+    return statement;
 }
 
-void parser::LOOP_STATEMENT() {
+ast::node_id parser::LOOP_STATEMENT() {
 
+    ast::node_id statement = tree->add(ast::loop_node, scan->this_offset());
     scan->must_be(symbol::loop_sym);
-    STATEMENT_LIST();
+    tree->add_child(statement, STATEMENT_LIST());
     scan->must_be(symbol::end_sym);
     scan->must_be(symbol::loop_sym);
+    return statement;
 }
 
-void parser::FOR_STATEMENT() {
+ast::node_id parser::FOR_STATEMENT() {
+    uint32_t at = scan->this_offset();
     scan->must_be(symbol::for_sym);
     
-    symbol* sym = new symbol(symbol::identifier);
-    token* tok = new token(sym, 0, 0);
-    tok->set_identifier_value(scan->get_current_identifier_name());
-    id_table_entry* for_entry = table->enter_id(tok, lille_type::type_integer, lille_kind::for_ident, table->scope(), 0, lille_type::type_unknown);
-    table->add_table_entry(for_entry);
+    symbol sym = symbol(symbol::identifier);
+    token* tok = new token(sym);
+    tok->set_name_id(declared_name());
     scan->must_be(symbol::identifier);
 
     scan->must_be(symbol::in_sym);
-    if (scan->have(symbol::reverse_sym)) {
+    bool reverse = scan->have(symbol::reverse_sym);
+    if (reverse) {
         scan->must_be(symbol::reverse_sym);
     }
-    scan->must_be(symbol::integer);
+    ast::node_id statement = tree->add(ast::for_node, at, lille_type::type_unknown, tok->get_name_id(), reverse);
+    // The bounds are <simple_expr>s, so IN and relational operators are left out
+    ast::node_id lower = EXPR(grammar::string_precedence);
+    tree->add_child(statement, lower);
+    operand_type(lower, lille_type::type_integer, 104);
     scan->must_be(symbol::range_sym);
-    scan->must_be(symbol::integer);
-    LOOP_STATEMENT();
-}
-
-void parser::WHILE_STATEMENT() {
-
-    scan->must_be(symbol::while_sym);
-    handle_if_and_while();
-    LOOP_STATEMENT();
-}
+    ast::node_id upper = EXPR(grammar::string_precedence);
+    tree->add_child(statement, upper);
+    operand_type(upper, lille_type::type_integer, 104);
 
-bool parser::IS_NUMBER() {
-    if (scan->have(symbol::real_num) or scan->have(symbol::integer)) 
-        return true;
-    return false;
-}
-
-bool parser::IS_ADDOP() {
-    if (scan->have(symbol::plus_sym) or scan->have(symbol::minus_sym)) 
-        return true;
-    return false;
+    // The loop variable is declared after the bounds, which may not refer to it
+    id_table_entry* for_entry = table->enter_id(tok, lille_type::type_integer, lille_kind::for_ident, table->scope(), 0, lille_type::type_unknown);
+    table->add_table_entry(for_entry);
+    tree->add_child(statement, LOOP_STATEMENT());
+    return statement;
 }
 
-bool parser::IS_MULTOP() {
-    if (scan->have(symbol::asterisk_sym) or scan->have(symbol::slash_sym))
-        return true;
-    return false;
-}
+ast::node_id parser::WHILE_STATEMENT() {
 
-bool parser::IS_RELOP() {
-    if (scan->have(symbol::less_than_sym) or scan->have(symbol::equals_sym) or scan->have(symbol::greater_than_sym) or scan->have(symbol::less_or_equal_sym) or scan->have(symbol::greater_or_equal_sym) or scan->have(symbol::not_equals_sym)) 
-        return true;
-    return false;
+    ast::node_id statement = tree->add(ast::while_node, scan->this_offset());
+    scan->must_be(symbol::while_sym);
+    tree->add_child(statement, handle_condition());
+    tree->add_child(statement, LOOP_STATEMENT());
+    return statement;
 }
 
 bool parser::IS_EXPR() {
-    if (scan->have(symbol::not_sym) or scan->have(symbol::odd_sym) or scan->have(symbol::left_paren_sym) or scan->have(symbol::identifier) or IS_NUMBER() or scan->have(symbol::strng) or IS_BOOL() or IS_ADDOP() or IS_NUMBER()) 
-        return true;
-    return false;
+    return scan->have(grammar::first_expr);
 }
 
 bool parser::IS_BOOL() {
-    if (scan->have(symbol::true_sym) or scan->have(symbol::false_sym)) 
-        return true;
-    return false;
+    return scan->have(grammar::boolean);
 }
 
 bool parser::IS_STATEMENT() {
-    if (scan->have(symbol::identifier) or scan->have(symbol::exit_sym) or scan->have(symbol::return_sym) or scan->have(symbol::read_sym) or scan->have(symbol::write_sym) or scan->have(symbol::writeln_sym) or scan->have(symbol::null_sym) or scan->have(symbol::if_sym) or scan->have(symbol::loop_sym) or scan->have(symbol::for_sym) or scan->have(symbol::while_sym))
-        return true;
-    return false;
+    return scan->have(grammar::first_statement);
 }
 
 bool parser::IS_DECLERATION() {
-    if (scan->have(symbol::identifier) or scan->have(symbol::procedure_sym) or scan->have(symbol::function_sym)) 
-        return true;
-    return false;
+    return scan->have(grammar::first_declaration);
 }
 
 lille_type parser::get_ident_type() {
-    switch (scan->this_token()->get_symbol()->get_sym()) {
+    switch (scan->this_token()->get_symbol().get_sym()) {
         case symbol::integer_sym:
             return lille_type::type_integer;
         case symbol::real_sym:
@@ -781,175 +607,227 @@ lille_type parser::get_ident_type() {
     }
 }
 
-void parser::handle_function_or_procedure_call(id_table_entry* current_entry) {
-    bool lp = false;
+ast::node_id parser::handle_function_or_procedure_call(id_table_entry* current_entry, uint32_t at) {
+    bool is_func = current_entry->tipe().is_type(lille_type::type_func);
+    lille_type returned = is_func ? current_entry->return_tipe() : lille_type();
+    ast::node_id call = tree->add(ast::call_node, at, returned, current_entry->name_id());
+
+    // A name already reported as undeclared has no parameters to check the arguments against
+    bool declared = is_func or current_entry->tipe().is_type(lille_type::type_proc);
+    int arity = declared ? current_entry->number_of_params() : 0;
+    int given = 0;
     if(scan->have(symbol::left_paren_sym)) {
         scan->must_be(symbol::left_paren_sym);
-        lp = true;
-    }
-
-    string current_entry_name = current_entry->name();
-    if(current_entry->tipe().is_type(lille_type::type_func)) {
-        /**** HANDEL FUNCTION CALL ****/
-        for(int i = 0; i < current_entry->number_of_params(); i++) {
-            if(scan->have(symbol::identifier)) {
-                current_ident = table->lookup(scan->get_current_identifier_name());
-                if(current_ident->kind().is_kind(lille_kind::for_ident)) {
-                    error->flag(scan->this_token(), 96);
-                }
-                else if(current_ident->tipe().is_type(lille_type::type_func)) {
-                    if(current_entry->nth_parameter(i)->kind().is_kind(lille_kind::ref_param)) {
-                        error->flag(scan->this_token(), 123);
-                    }
-                    if(not current_entry->nth_parameter(i)->tipe().is_type(current_ident->return_tipe())) {
-                        throw lille_exception("Identifier " + current_ident->name() + " Does Not Match Parameter Type in " + current_entry_name);
-                    }
-                }
-                else if(not current_entry->nth_parameter(i)->tipe().is_type(current_ident->tipe())) {
-                    throw lille_exception("Identifier " + current_ident->name() + " Does Not Match Parameter Type in " + current_entry_name);
-                }
-                scan->must_be(symbol::identifier);
-            }
-            else {
-                if(not current_entry->nth_parameter(i)->tipe().is_type(get_type())) 
-                    throw lille_exception("Value Given Does Not Match Parameter Type in " + current_entry_name);
-                if(scan->have(symbol::integer))
-                   scan->must_be(symbol::integer);
-                else if(scan->have(symbol::real_num))
-                    scan->must_be(symbol::real_num);
-                else if(scan->have(symbol::strng))
-                    scan->must_be(symbol::strng);
-                else if(scan->have(symbol::true_sym))
-                    scan->must_be(symbol::true_sym);
-                else if(scan->have(symbol::false_sym))
-                    scan->must_be(symbol::false_sym);
-                else throw lille_exception("Invalid type given");
-            }
-            if(scan->have(symbol::comma_sym))
-                scan->must_be(symbol::comma_sym);
-        }
-    }
-    else if(current_entry->tipe().is_type(lille_type::type_proc)) {
-        /**** HANDEL PROCEDURE CALL ****/
-        for(int i = 0; i < current_entry->number_of_params(); i++) {
-            if(scan->have(symbol::identifier)) {
-                current_ident = table->lookup(scan->get_current_identifier_name());
-                if(current_ident->kind().is_kind(lille_kind::value_param) and current_entry->nth_parameter(i)->kind().is_kind(lille_kind::ref_param)) {
-                    error->flag(scan->this_token(), 98);
-                }
-                else if(current_ident->kind().is_kind(lille_kind::for_ident) and not current_entry->nth_parameter(i)->kind().is_kind(lille_kind::value_param)) {
-                    throw lille_exception("Cannot pass FOR loop identifier into procedure");
-                }
-                else if(current_ident->tipe().is_type(lille_type::type_func)) {
-                    if(current_entry->nth_parameter(i)->kind().is_kind(lille_kind::ref_param)) {
-                        error->flag(scan->this_token(), 123);
-                    }
-                    if(not current_entry->nth_parameter(i)->tipe().is_type(current_ident->return_tipe())) {
-                        throw lille_exception("Identifier " + current_ident->name() + " Does Not Match Parameter Type in " + current_entry_name);
-                    }
-                }
-                else if(not current_entry->nth_parameter(i)->tipe().is_type(current_ident->tipe())) {
-                    throw lille_exception("Identifier " + current_ident->name() + " Does Not Match Parameter Type in " + current_entry_name);
-                }
-                scan->must_be(symbol::identifier);
-            }
-            else {
-                if(not current_entry->nth_parameter(i)->tipe().is_type(get_type())) 
-                    throw lille_exception("Value Given Does Not Match Parameter Type in " + current_entry_name);
-                if(scan->have(symbol::integer))
-                   scan->must_be(symbol::integer);
-                else if(scan->have(symbol::real_num))
-                    scan->must_be(symbol::real_num);
-                else if(scan->have(symbol::strng))
-                    scan->must_be(symbol::strng);
-                else if(scan->have(symbol::true_sym))
-                    scan->must_be(symbol::true_sym);
-                else if(scan->have(symbol::false_sym))
-                    scan->must_be(symbol::false_sym);
-                else throw lille_exception("Invalid type given");
-            }
-            if(scan->have(symbol::comma_sym))
+        bool comma_flag;
+        do {
+            ast::node_id argument = EXPR(grammar::relation_precedence);
+            tree->add_child(call, argument);
+            if(given < arity)
+                check_argument(current_entry->nth_parameter(given), argument);
+            else if(declared and given == arity)
+                flag(argument, 100);
+            given++;
+            comma_flag = scan->have(symbol::comma_sym);
+            if(comma_flag)
                 scan->must_be(symbol::comma_sym);
         }
-        
+        while(comma_flag);
+        scan->must_be(symbol::right_paren_sym);
     }
-    else throw lille_exception("Unkown Function/Procedure " + current_entry_name);
+    if(given < arity)
+        flag(call, 97);
+    return call;
+}
 
-    if(lp) {
-        scan->must_be(symbol::right_paren_sym);
+void parser::check_argument(id_table_entry* formal, ast::node_id argument) {
+    // A reference parameter needs a variable or parameter, passed as it is, of exactly its type. A value
+    // parameter takes any expression that could be assigned to it. When the argument is a lone identifier it
+    // was the last operand parsed, so current_ident is its entry.
+    if(formal->kind().is_kind(lille_kind::ref_param)) {
+        bool variable = (*tree)[argument].kind == ast::identifier_node
+                and (current_ident->kind().is_kind(lille_kind::variable)
+                    or current_ident->kind().is_kind(lille_kind::value_param)
+                    or current_ident->kind().is_kind(lille_kind::ref_param));
+        if(not variable and not type_of(argument).is_type(lille_type::type_unknown))
+            flag(argument, 99);
+        else if(mismatch(formal->tipe(), type_of(argument)))
+            flag(argument, 98);
     }
+    else if(not assignable(formal->tipe(), type_of(argument)))
+        flag(argument, 98);
 }
 
-void parser::handle_if_and_while() {
+ast::node_id parser::handle_condition() {
+    ast::node_id condition = EXPR(grammar::relation_precedence);
+    operand_type(condition, lille_type::type_boolean, 103);
+    return condition;
+}
 
-    bool and_or_flag;
-    do {
-        if(scan->have(symbol::identifier)) {
-            id_table_entry* if_cond = table->lookup(scan->get_current_identifier_name());
-            if(if_cond == NULL)
-                throw lille_exception("Undeclared identifier " + scan->get_current_identifier_name());
+ast::node_id parser::EXPR(int min_precedence) {
+    // Precedence climbing: each operator takes as its right operand everything up to the next operator that
+    // binds no tighter, and the operators found on the way become the left operands of the looser ones.
+    // After a relational operator, IN or ** only looser operators may follow.
+    ast::node_id left = PRIMARY();
+    int level = grammar::precedence(scan->this_symbol());
+    int max_precedence = grammar::power_precedence;
+    while(level >= min_precedence and level <= max_precedence) {
+        ast::node_id op = make_operator();
+        bool in_range = scan->have(symbol::in_sym);
+        scan->get_token();
+        if(left != ast::no_node)
+            (*tree)[op].offset = (*tree)[left].offset;     // where the expression it heads begins
+        tree->add_child(op, left);
+        if(in_range) {
+            tree->add_child(op, EXPR(grammar::string_precedence));
+            scan->must_be(symbol::range_sym);
+            tree->add_child(op, EXPR(grammar::string_precedence));
+        }
+        else
+            tree->add_child(op, EXPR(level + 1));
+        infer_type(op);
+        left = op;
+        max_precedence = grammar::associative(level) ? level : level - 1;
+        level = grammar::precedence(scan->this_symbol());
+    }
+    return left;
+}
+
+ast::node_id parser::PRIMARY() {
+    // Parentheses, NOT, ODD, signs and arguments nest one operand in another, each a level deeper on the stack
+    if (++expression_depth > max_nesting) {
+        error->flag(scan->this_token(), 125);
+        throw lille_exception("Expressions nested more than " + to_string(max_nesting) + " deep.");
+    }
+    uint32_t at = scan->this_offset();
+    ast::node_id operand = ast::no_node;
+    switch(scan->this_symbol()) {
+        case symbol::identifier: {
+            // The identifier is looked up once; a function is called, with its arguments, where it stands
+            id_table_entry* entry = lookup_ident();
+            lille_type ty = entry->tipe();
             scan->must_be(symbol::identifier);
-            if(IS_RELOP()) {
-                if (scan->have(symbol::greater_than_sym)) 
-                    scan->must_be(symbol::greater_than_sym);
-                else if (scan->have(symbol::less_than_sym)) 
-                    scan->must_be(symbol::less_than_sym);
-                else if (scan->have(symbol::equals_sym)) 
-                    scan->must_be(symbol::equals_sym);
-                else if (scan->have(symbol::not_equals_sym)) 
-                    scan->must_be(symbol::not_equals_sym);
-                else if (scan->have(symbol::less_or_equal_sym)) 
-                    scan->must_be(symbol::less_or_equal_sym);
-                else  if (scan->have(symbol::greater_or_equal_sym))
-                    scan->must_be(symbol::greater_or_equal_sym);
-                else
-                    throw lille_exception("Expected a logical symbol (> < <> = >= <=)");
-                if(scan->have(symbol::identifier)) {
-                    id_table_entry* if_cond2 = table->lookup(scan->get_current_identifier_name());
-                    if(if_cond2 == NULL)
-                        throw lille_exception("Undeclared identifier " + scan->get_current_identifier_name());
-                    if(not if_cond->tipe().is_type(if_cond2->tipe())) 
-                        throw lille_exception("Cannot compare 2 items of different types");
-                }
-                else if(scan->have(symbol::integer) or scan->have(symbol::real_num)) {
-                    if(not if_cond->tipe().is_type(get_type()))
-                        throw lille_exception("Can only compare values of same type");
-                    if(scan->have(symbol::integer))
-                        scan->must_be(symbol::integer);
-                    else
-                        scan->must_be(symbol::real_num);
-                }
-                else if(scan->have(symbol::true_sym)) {
-                    scan->must_be(symbol::true_sym);
-                }
-                else if(scan->have(symbol::false_sym)) {
-                    scan->must_be(symbol::false_sym);
-                }
-                else throw lille_exception("Invalid argument for loop");
+            // A procedure, or a name already reported as undeclared, is only called if arguments follow
+            bool arguments = scan->have(symbol::left_paren_sym);
+            if(ty.is_type(lille_type::type_func)
+                    or (arguments and (ty.is_type(lille_type::type_proc) or ty.is_type(lille_type::type_unknown))))
+                operand = handle_function_or_procedure_call(entry, at);
+            else
+                operand = tree->add(ast::identifier_node, at, ty, entry->name_id());
+            if(ty.is_type(lille_type::type_proc) or ty.is_type(lille_type::type_prog)) {
+                flag(operand, 91);      // has no value
+                (*tree)[operand].type = lille_type::type_unknown;
             }
-            else if(not if_cond->tipe().is_type(lille_type::type_boolean)) {
-                throw lille_exception("Invalid argument for loop");
-            }        
+            current_ident = entry;      // after any arguments, for check_argument()
+            break;
         }
-        else if(scan->have(symbol::true_sym)) {
-            scan->must_be(symbol::true_sym);
+        case symbol::integer:
+        case symbol::real_num:
+        case symbol::strng:
+        case symbol::true_sym:
+        case symbol::false_sym:
+            operand = make_literal();
+            scan->get_token();
+            break;
+        case symbol::not_sym:
+        case symbol::odd_sym:
+            operand = make_operator();
+            scan->get_token();
+            tree->add_child(operand, EXPR(grammar::relation_precedence));
+            infer_type(operand);
+            break;
+        case symbol::plus_sym:
+        case symbol::minus_sym:
+            operand = make_operator();
+            scan->get_token();
+            tree->add_child(operand, PRIMARY());
+            infer_type(operand);
+            break;
+        case symbol::left_paren_sym:
+            scan->must_be(symbol::left_paren_sym);
+            operand = EXPR(grammar::relation_precedence);
+            scan->must_be(symbol::right_paren_sym);
+            break;
+        default:
+            error->syntax(symbol::identifier, scan->this_token(), 92);
+            break;
+    }
+    expression_depth--;
+    return operand;
+}
+
+void parser::infer_type(ast::node_id op) {
+    // An operand of the wrong type is reported, and the result is then unknown, so nothing that uses it is
+    // reported as well.
+    ast::node_id left = (*tree)[op].first_child;
+    ast::node_id right = (left == ast::no_node) ? ast::no_node : (*tree)[left].next_sibling;
+    lille_type result = lille_type::type_unknown;
+    switch((*tree)[op].op) {
+        case symbol::plus_sym:
+        case symbol::minus_sym:
+        case symbol::asterisk_sym:
+        case symbol::slash_sym: {
+            lille_type l = operand_type(left, lille_type::type_arith, 118);
+            if((*tree)[op].first_child == (*tree)[op].last_child)
+                result = l;     // unary + or -
+            else {
+                lille_type r = operand_type(right, lille_type::type_arith, 118);
+                if(l.is_type(lille_type::type_unknown) or r.is_type(lille_type::type_unknown))
+                    result = lille_type::type_unknown;
+                else if(l.is_type(lille_type::type_real) or r.is_type(lille_type::type_real))
+                    result = lille_type::type_real;
+                else
+                    result = lille_type::type_integer;
+            }
+            break;
         }
-        else if(scan->have(symbol::false_sym)) {
-            scan->must_be(symbol::false_sym);
+        case symbol::power_sym: {
+            lille_type l = operand_type(left, lille_type::type_arith, 118);
+            if(not operand_type(right, lille_type::type_integer, 119).is_type(lille_type::type_unknown))
+                result = l;
+            break;
         }
-        else throw lille_exception("Invalid argument for `if`");
-
-        if(scan->have(symbol::and_sym)) {
-                scan->must_be(symbol::and_sym);
-                and_or_flag = true;
+        case symbol::ampersand_sym:
+            result = both(left, right, lille_type::type_string, 115, lille_type::type_string);
+            break;
+        case symbol::and_sym:
+        case symbol::or_sym:
+            result = both(left, right, lille_type::type_boolean, 117, lille_type::type_boolean);
+            break;
+        case symbol::not_sym:
+            result = both(left, ast::no_node, lille_type::type_boolean, 117, lille_type::type_boolean);
+            break;
+        case symbol::odd_sym:
+            result = both(left, ast::no_node, lille_type::type_integer, 119, lille_type::type_boolean);
+            break;
+        case symbol::in_sym: {
+            // The value and both bounds are integers
+            result = lille_type::type_boolean;
+            for(ast::node_id n = left; n != ast::no_node; n = (*tree)[n].next_sibling)
+                if(operand_type(n, lille_type::type_integer, 104).is_type(lille_type::type_unknown))
+                    result = lille_type::type_unknown;
+            break;
         }
-        else if(scan->have(symbol::or_sym)) {
-            scan->must_be(symbol::or_sym);
-            and_or_flag = true;
+        default: {
+            // A relational operator compares two numbers, or two values of the same type
+            lille_type l = type_of(left), r = type_of(right);
+            bool numbers = fits(l, lille_type::type_arith) and fits(r, lille_type::type_arith);
+            if(l.is_type(lille_type::type_unknown) or r.is_type(lille_type::type_unknown))
+                result = lille_type::type_unknown;
+            else if(l.is_type(r) or numbers)
+                result = lille_type::type_boolean;
+            else
+                flag(right, 114);
+            break;
         }
-        else and_or_flag = false;
     }
-    while(and_or_flag);
+    (*tree)[op].type = result.get_type();
+}
+
+lille_type parser::both(ast::node_id left, ast::node_id right, lille_type::lille_ty wanted, int error_no, lille_type::lille_ty result) {
+    bool known = not operand_type(left, wanted, error_no).is_type(lille_type::type_unknown);
+    if(right != ast::no_node)
+        known = not operand_type(right, wanted, error_no).is_type(lille_type::type_unknown) and known;
+    return known ? result : lille_type::type_unknown;
 }
 
 lille_type parser::get_type() {
@@ -959,11 +837,116 @@ lille_type parser::get_type() {
         return lille_type::type_real;
     else if(scan->have(symbol::strng))
         return lille_type::type_string;
-    else if(scan->have(symbol::true_sym) or scan->have(symbol::false_sym))
+    else if(IS_BOOL())
         return lille_type::type_boolean;
     else return lille_type::type_unknown;
 }
 
+id_table_entry* parser::lookup_ident() {
+    // An undeclared identifier is reported once, then declared in the current scope with an unknown type,
+    // which every later check accepts. Anything other than an identifier gets an unnamed entry of unknown
+    // type, and its syntax error is left to must_be().
+    id_table_entry* entry = NULL;
+    if(scan->have(symbol::identifier))
+        entry = table->lookup(scan->get_current_identifier_id());
+    if(entry == NULL) {
+        token* tok;
+        if(scan->have(symbol::identifier)) {
+            error->flag(scan->this_token(), 81);
+            tok = new token(symbol(symbol::identifier));
+            tok->set_name_id(scan->get_current_identifier_id());
+        }
+        else tok = new token();
+        entry = table->enter_id(tok, lille_type::type_unknown, lille_kind::unknown, table->scope(), 0, lille_type::type_unknown);
+        table->add_table_entry(entry);
+    }
+    return entry;
+}
+
+bool parser::mismatch(lille_type a, lille_type b) {
+    // The unknown type belongs to something already reported, so it matches anything
+    return not a.is_type(b) and not a.is_type(lille_type::type_unknown) and not b.is_type(lille_type::type_unknown);
+}
+
+bool parser::assignable(lille_type to, lille_type from) {
+    // An integer is converted to a real where need be
+    return not mismatch(to, from) or (to.is_type(lille_type::type_real) and from.is_type(lille_type::type_integer));
+}
+
+bool parser::fits(lille_type given, lille_type::lille_ty wanted) {
+    if(given.is_type(wanted))
+        return true;
+    bool number = given.is_type(lille_type::type_integer) or given.is_type(lille_type::type_real);
+    if(wanted == lille_type::type_arith)
+        return number;
+    if(wanted == lille_type::type_arith_or_string)
+        return number or given.is_type(lille_type::type_string);
+    return false;
+}
+
+lille_type parser::type_of(ast::node_id n) {
+    if(n == ast::no_node)
+        return lille_type::type_unknown;
+    return lille_type::lille_ty((*tree)[n].type);
+}
+
+lille_type parser::operand_type(ast::node_id operand, lille_type::lille_ty wanted, int error_no) {
+    // The type of operand if it is wanted. Otherwise the operand is reported, unless its type is unknown
+    // already, and its type is taken to be unknown from here on.
+    lille_type given = type_of(operand);
+    if(fits(given, wanted))
+        return given;
+    if(not given.is_type(lille_type::type_unknown))
+        flag(operand, error_no);
+    return lille_type::type_unknown;
+}
+
+void parser::flag(ast::node_id n, int error_no) {
+    if(n == ast::no_node)
+        return;
+    token at(symbol(), (*tree)[n].offset);
+    error->flag(&at, error_no);
+}
+
+int parser::declared_name() {
+    // Only an identifier names what is declared; must_be() reports anything else
+    if(not scan->have(symbol::identifier))
+        return name_table::no_name;
+    return scan->get_current_identifier_id();
+}
+
+ast::node_id parser::make_identifier(id_table_entry* entry) {
+    if(not scan->have(symbol::identifier))
+        return ast::no_node;
+    return tree->add(ast::identifier_node, scan->this_offset(), entry->tipe(), scan->get_current_identifier_id());
+}
+
+ast::node_id parser::make_literal() {
+    token* literal = scan->this_token();
+    uint32_t value = 0;
+    switch(literal->get_sym()) {
+        case symbol::integer:
+        case symbol::real_num:
+            value = literal->get_payload();
+            break;
+        case symbol::strng:
+            value = tree->add_string(literal->get_string_value());
+            break;
+        case symbol::true_sym:
+            value = 1;
+            break;
+        case symbol::false_sym:
+            break;
+        default:
+            return ast::no_node;
+    }
+    return tree->add(ast::literal_node, scan->this_offset(), get_type(), value);
+}
+
+ast::node_id parser::make_operator() {
+    return tree->add(ast::operator_node, scan->this_offset(), lille_type(), 0, scan->this_symbol());
+}
+
 list<token*> parser::IDENT_LIST() {
     // create an array of tokens to store all variables and their names
         list<token*> variables;
@@ -974,9 +957,9 @@ list<token*> parser::IDENT_LIST() {
             // For each identifier found ->
             if(scan->have(symbol::identifier)) {
                 // Add the new variable into the array
-                variables.push_back(new token(new symbol(symbol::identifier), 0, 0));
+                variables.push_back(new token(symbol(symbol::identifier), scan->this_offset()));
                 // Assign the name to the token
-                variables.back()->set_identifier_value(scan->get_current_identifier_name());
+                variables.back()->set_name_id(scan->get_current_identifier_id());
                 scan->must_be(symbol::identifier);
             }
             // If there are more variables ->
@@ -989,7 +972,7 @@ list<token*> parser::IDENT_LIST() {
     return variables;
 }
 
-void parser::PARAM() {
+void parser::PARAM(ast::node_id routine) {
     
     id_table_entry* id;
     if(scan->have(symbol::left_paren_sym)) {
@@ -1000,14 +983,14 @@ void parser::PARAM() {
         do {
             // If a new parameter is found ->
             if(scan->have(symbol::identifier)) {
-                symbol* sym = new symbol(symbol::identifier);
-                token* ident = new token(sym, 0, 0);
-                ident->set_identifier_value(scan->get_current_identifier_name());
+                symbol sym = symbol(symbol::identifier);
+                token* ident = new token(sym, scan->this_offset());
+                ident->set_name_id(scan->get_current_identifier_id());
                 scan->must_be(symbol::identifier);
                 scan->must_be(symbol::colon_sym);
                 // Get the kind of param (ref or value)
-                int k = scan->this_token()->get_symbol()->get_sym();
-                lille_kind knd = lille_kind::unknown;
+                int k = scan->this_token()->get_symbol().get_sym();
+                lille_kind::lille_knd knd = lille_kind::unknown;
                 switch(k) {
                     case symbol::ref_sym: {
                         scan->must_be(symbol::ref_sym);
@@ -1041,12 +1024,13 @@ void parser::PARAM() {
                     scan->must_be(symbol::boolean_sym);
                 }
 
-                id = table->enter_id(ident, ty, knd, table->scope(), 0, lille_type::type_unknown);
+                id = table->enter_param(ident, ty, knd, table->scope(), 0);
+                // add the entry to the table
+                table->add_table_entry(id);
+                // link the parameter to the procedure
+                current_fun_or_proc->add_param(id);
+                tree->add_child(routine, tree->add(ast::param_node, ident->get_offset(), ty, ident->get_name_id(), knd));
             }
-            // add the entry to the table
-            table->add_table_entry(id);
-            // link the parameter to the procedure
-            current_fun_or_proc->add_param(id);
 
             // If a semi-colon is found, keep going
             semi_flag = scan->have(symbol::semicolon_sym);
@@ -9,6 +9,7 @@
 #include "id_table.h"
 #include "symbol.h"
 #include "scanner.h"
+#include "ast.h"
 
 using namespace std;
 
@@ -17,36 +18,53 @@ public:
 
     parser(scanner* s, id_table* t, error_handler* e);
     ~ parser();
-    void PROG(); 
+    ast::node_id PROG();
+    // Parses a program and returns the root of its syntax tree.
+
+    ast* syntax_tree();
+    // The tree built by PROG(). It belongs to the parser.
+
+    void restart(id_table* t);
+    // Makes ready to parse the source again, after the scanner has been moved back to its first token by an
+    // edit. Declarations are entered in t from now on; the old table is deleted and the syntax tree released.
 
 private:
 
     bool debug {false};
 
+    // Procedures and functions may be nested this deeply, and so may IF, LOOP, FOR and WHILE statements, and
+    // operands within an expression. Unoptimised, a level of declaration costs about 700 bytes of native stack,
+    // a compound statement about 500 and an operand about 300, so even all three budgets used up at once take
+    // about 7MB, inside a default 8MB stack.
+    static const int max_nesting = 5000;
+    int nesting_depth;      // Procedure and function declarations currently open.
+    int statement_depth;    // Compound statements currently open, one inside another.
+    int expression_depth;   // Operands currently open, one inside another.
+
     scanner* scan; // Copy of scanner
     id_table* table;
     error_handler* error;
 
-    // Functions
-    void BLOCK(); 
-    void DECLERATION(); 
-    void STATEMENT_LIST();
-    void STATEMENT();
-    void SIMPLE_STATEMENT();
-    void COMPOUND_STATEMENT();
-    void IF_STATEMENT();
-    void LOOP_STATEMENT();
-    void FOR_STATEMENT();
-    void WHILE_STATEMENT();
-
-    // Boolean Functions
+    ast* tree;
+
+    // Functions, each returning the node it adds to the syntax tree
+    ast::node_id BLOCK(); 
+    ast::node_id DECLERATION(); 
+    ast::node_id STATEMENT_LIST();
+    ast::node_id STATEMENT();
+    ast::node_id SIMPLE_STATEMENT();
+    ast::node_id COMPOUND_STATEMENT();
+    ast::node_id IF_STATEMENT();
+    ast::node_id LOOP_STATEMENT();
+    ast::node_id FOR_STATEMENT();
+    ast::node_id WHILE_STATEMENT();
+    ast::node_id EXPR(int min_precedence);  // Operands joined by operators of grammar::precedence min_precedence and up
+    ast::node_id PRIMARY();                 // An operand, with any unary operator applied to it
+
+    // Boolean Functions, each one test of the current symbol against a set in grammar.h
     bool IS_EXPR();
     bool IS_BOOL();
-    bool IS_RELOP();
-    bool IS_MULTOP();
-    bool IS_ADDOP();
     bool IS_PRIMARY();
-    bool IS_NUMBER();
     bool IS_DECLERATION();
     bool IS_STATEMENT();
 
@@ -56,11 +74,31 @@ private:
     id_table_entry* current_entry;
     id_table_entry* current_fun_or_proc;
     id_table_entry* current_ident;
-    void handle_function_or_procedure_call(id_table_entry* current_entry);
-    void handle_if_and_while();
+    ast::node_id handle_function_or_procedure_call(id_table_entry* current_entry, uint32_t at);    // at: where the call begins
+    ast::node_id handle_condition();            // The boolean expression of IF, ELSIF, WHILE or EXIT WHEN
     lille_type get_type();
+    id_table_entry* lookup_ident();             // Entry of the identifier at the current symbol, never NULL
+    bool mismatch(lille_type a, lille_type b);  // Whether a and b differ, neither being unknown
+    bool assignable(lille_type to, lille_type from);    // Whether a from value can be stored in a to variable
+
+    // Type checking of expressions, as each node is built
+    bool fits(lille_type given, lille_type::lille_ty wanted);  // type_arith fits a number, type_arith_or_string a string too
+    lille_type type_of(ast::node_id n);         // Unknown for no_node
+    lille_type operand_type(ast::node_id operand, lille_type::lille_ty wanted, int error_no);
+                                                // Its type if it fits wanted, else reports error_no and is unknown
+    void infer_type(ast::node_id op);           // Sets the type of operator node op from its operands
+    lille_type both(ast::node_id left, ast::node_id right, lille_type::lille_ty wanted, int error_no, lille_type::lille_ty result);
+                                                // result if left and right, if any, are wanted, else unknown
+    void check_argument(id_table_entry* formal, ast::node_id argument);    // Reports an argument formal cannot take
+    void flag(ast::node_id n, int error_no);    // Reports an error at the start of node n
+
+    // Syntax tree nodes for the current symbol, which is not consumed
+    ast::node_id make_identifier(id_table_entry* entry);   // An identifier, declared by entry
+    int declared_name();                        // Name ID of the identifier being declared, or no_name if it is missing
+    ast::node_id make_literal();                            // A number, string, TRUE or FALSE
+    ast::node_id make_operator();
     list<token*> IDENT_LIST();
-    void PARAM();
+    void PARAM(ast::node_id routine);   // Adds a node for each parameter to routine
 };
 
 #endif
@@ -4,6 +4,11 @@
 #include <string>
 #include <cctype>
 #include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <charconv>
+#include <system_error>
 #include <algorithm> 
 #include <string>  
 #include <functional>
@@ -14,6 +19,11 @@
 #include "token.h"
 #include "scanner.h"
 #include "lille_exception.h"
+#include "token_pool.h"
+#include "name_table.h"
+#include "time_report.h"
+#include "simd_scan.h"
+#include "token_stream.h"
 
 using namespace std;
 
@@ -24,34 +34,62 @@ scanner::scanner()
 	line_number = 0;
 	eoln_flag = true;	// assume end of line is true before reading anything from the input buffer.
 	eof_flag = false;
-	input_buffer = "";
+	line_start = NULL;
+	line_end = NULL;
+	unread = NULL;
+	last_line_read = false;
+	text_end = NULL;
+	pragma_at_end = false;
+	pragma_skipped = false;
+	owns_source = false;
+	sync = symbol_set();
+	source = NULL;
 	next_char = end_marker;
-	current_symbol = new symbol();
-	current_token = new token();
-	current_line_number = 0;
-	current_pos_on_line = 0;
+	current_symbol = symbol();
+	tokens = new token_pool();
+	current_token = tokens->allocate(symbol(symbol::nul), source_buffer::no_offset);
+	stream = NULL;
+	cursor = 0;
+	next_held_error = 0;
+	stream_name_id = name_table::no_name;
+	current_offset = source_buffer::no_offset;
 	current_integer_value = 0;
 	current_real_value = 0.0;
 	current_string_value = "";
-	current_identifier_name = "";	
+	current_identifier_name = "";
+	current_identifier_id = name_table::no_name;
+	names = NULL;		// specified by public constructor
 	error = NULL;		// specified by public constructor
 	id_tab = NULL;		// specified by public constructor
 	debugging = false;
 }
 
 
-scanner::scanner(string source_filename, id_table* id_t, error_handler* e) : scanner::scanner()
-// Open source file. Raise exception if it is not present.
+scanner::scanner(source_buffer* src, name_table* n, id_table* id_t, error_handler* e) : scanner::scanner()
+// Scan the already mapped source file.
 {
+	names = n;
 	id_tab = id_t;
 	error = e;
-	if (filesystem::exists(source_filename))		// Check file exists
-		source_file.open(source_filename);          // Open default file for reading.
-	else
-	{
-		cerr << "Source code file not found." << endl;
-		throw lille_exception("Source code file not found.");
-	}
+	source = src;
+	unread = source->begin();
+	text_end = NULL;			// the end of the source, wherever that turns out to be if it is streamed
+	if (source->is_streamed())
+		tokens->recycle();		// the parser never holds on to a token, so a streamed source needs only one block
+	get_line();
+}
+
+
+scanner::scanner(source_buffer* src, name_table* n, id_table* id_t, error_handler* e, const char* from, const char* to)
+	: scanner::scanner()
+// Scan the lines of the already mapped source file from from up to to.
+{
+	names = n;
+	id_tab = id_t;
+	error = e;
+	source = src;
+	unread = from;
+	text_end = (to == source->end()) ? NULL : to - 1;		// the '\n' ending the last line of the part
 	get_line();
 }
 
@@ -254,10 +292,10 @@ void scanner::get_char()
 {
 	// gets the next character from the input stream. Checks for end of line and end of file.
 
-	if ((pos_on_line + 1) < input_buffer.length())
+	if (line_start + pos_on_line + 1 < line_end)
 	{
 		pos_on_line++;
-		next_char = input_buffer.at(pos_on_line);
+		next_char = line_start[pos_on_line];
 		eoln_flag = false;
 	}
 	else
@@ -265,33 +303,59 @@ void scanner::get_char()
 }
 
 
-char scanner::following_char()
+void scanner::skip_blanks()
+// Advance to the next character on the current line that is not blank, or to the next line if there is none.
+// Equivalent to calling get_char() until next_char > ' ', but the line is searched 16 or 32 bytes at a time.
 {
-	// return the character after next_char;
-	//if (pos_on_line < (input_buffer.length()-1))
-	if ((!eof_flag) and ((pos_on_line + 1) < input_buffer.length()))
-		return input_buffer.at(pos_on_line + 1);
+	const char* p = line_start + pos_on_line + 1;
+	if ((p < line_end) and (*p <= ' '))		// most gaps are a single blank, so only search runs of two or more
+		p = simd_scan::skip_blanks(p + 1, line_end, source->end() + 1);
+	if (p < line_end)
+	{
+		pos_on_line = p - line_start;
+		next_char = *p;
+		eoln_flag = false;
+	}
 	else
-		return end_marker;;
+		fill_buffer();
+}
+
+
+char scanner::following_char()
+{
+	// return the character after next_char. The current line is always followed by its '\n' or by the
+	// buffer's sentinel, so no bounds check is needed: at the end of a line the terminator is returned,
+	// and it never matches a character that continues a token.
+	return line_start[pos_on_line + 1];
 }
 
 
 void scanner::get_line()
+// Point line_start and line_end at the next line of the source buffer. No characters are copied.
+// A source that ends in '\n' yields a final empty line, as reading the file with getline() did.
 {
-	if (!source_file.eof())
+	if (!last_line_read)
 	{
-		getline(source_file, input_buffer);
+		line_start = unread;
+		unread = source->next_line(line_start, line_end);
+		last_line_read = (line_end == ((text_end != NULL) ? text_end : source->end()));
 		line_number++;
+
+		// A streamed source is gone once scanned, so the error handler keeps the lines it may need to list.
+		// Like the listing of a whole file, it leaves out the empty line after a final '\n'.
+		if (source->is_streamed() and ((line_start < line_end) or !last_line_read))
+			error->source_line(line_number, line_start, line_end);
 	}
 	else
 	{
 		eof_flag = true;
-		input_buffer = "";
+		line_start = source->end();
+		line_end = source->end();
 	}
 
 	if (debugging)
 	{
-		cout << "In GET_LINE " << line_number << ":  >" << input_buffer << "<" << endl;
+		cout << "In GET_LINE " << line_number << ":  >" << string(line_start, line_end) << "<" << endl;
 	}
 }
 
@@ -307,16 +371,18 @@ void scanner::fill_buffer()
 
 
 
-token* scanner::get_token()
-// Get the current token from the input stream. It is held in the private variable current_token.
+bool scanner::scan_token()
+// Find the next token in the input and leave its symbol, position and value in the current_ variables,
+// without building a token for it. Pragmas are acted on here, so the token found is never a pragma.
+// Returns false if the end of the file was reached first.
 {
 	//skip whitespace and comments to find start of next token.
 	while ((!eof_flag) and ((next_char <= ' ') or ((next_char == '-') and (following_char() == '-'))))
 	{
-		// skip whitespace
+		// skip whitespace, a vector at a time
 		while ((!eof_flag) and (next_char <= ' '))
 		{
-			get_char();
+			skip_blanks();
 		}
 
 		// skip comments
@@ -325,10 +391,12 @@ token* scanner::get_token()
 	}
 
 	// initialize variables to record token identified and its current location in the source file;
-	current_symbol = new symbol(symbol::end_of_program);	// This is the token returned if at end of file.
+	current_symbol = symbol(symbol::end_of_program);	// This is the token returned if at end of file.
 
-	current_line_number = line_number;
-	current_pos_on_line = pos_on_line;
+	current_offset = source->offset_of(eof_flag ? source->end() : line_start + pos_on_line);
+	pragma_skipped = false;
+	current_identifier_name = string_view();		// only a token spelled with letters has a name
+	current_identifier_id = name_table::no_name;
 
 
 	if (!eof_flag)	// If not at end of file
@@ -340,35 +408,56 @@ token* scanner::get_token()
 		else
 			scan_special_symbol();
 
-		switch (current_symbol->get_sym())
+		if (current_symbol.get_sym() == symbol::pragma_sym)		// pragmas are handled by the scanner not the parser
+		{
+			parse_pragma();				// pragma can appear anywhere in the code.
+			pragma_skipped = true;
+		}
+		return true;
+	}
+	return false;
+}
+
+
+token* scanner::get_token()
+// Get the current token from the input stream. It is held in the private variable current_token.
+{
+	time_report::phase_guard timing(time_report::scanner_phase);
+
+	if (stream != NULL)
+	{
+		advance();
+		return this_token();
+	}
+
+	if (scan_token())
+	{
+		switch (current_symbol.get_sym())
 		{
 		case symbol::identifier:
-			current_token = new token(new symbol(symbol::identifier), current_line_number, current_pos_on_line);
-			current_token->set_identifier_value(current_identifier_name);
+			current_token = tokens->allocate(symbol(symbol::identifier), current_offset);
+			current_token->set_name_id(current_identifier_id);
 			break;
 		case symbol::strng:
-			current_token = new token(new symbol(symbol::strng), current_line_number, current_pos_on_line);
+			current_token = tokens->allocate(symbol(symbol::strng), current_offset);
 			current_token->set_string_value(current_string_value);
 			break;
 		case symbol::integer:
-			current_token = new token(new symbol(symbol::integer), current_line_number, current_pos_on_line);
+			current_token = tokens->allocate(symbol(symbol::integer), current_offset);
 			current_token->set_integer_value(current_integer_value);
 			break;
 		case symbol::real_num:
-			current_token = new token(new symbol(symbol::real_num), current_line_number, current_pos_on_line);
+			current_token = tokens->allocate(symbol(symbol::real_num), current_offset);
 			current_token->set_real_value(current_real_value);
 			break;
-		case symbol::pragma_sym:		// pragmas are handled by the scanner not the parser
-			parse_pragma();				// pragma can appear anywhere in the code.
-			break;
 		default:
-			current_token = new token(current_symbol, current_line_number, current_pos_on_line);
+			current_token = tokens->allocate(current_symbol, current_offset);
 		}
 	}
 	else
 	{
 		// At eof. Set token to end_of_program to indicate end of input.
-		current_token = new token(new symbol(symbol::end_of_program), line_number, pos_on_line);
+		current_token = tokens->allocate(symbol(symbol::end_of_program), current_offset);
 			// This is the token returned if at end of file.
 			// The parser needs to process this to make sure that
 			// there is no extraneous text after the end of the
@@ -382,13 +471,274 @@ token* scanner::get_token()
 		current_token->print_token();
 	}
 
+	time_report::count(time_report::tokens_counter);
 	return current_token;
 }
 
 
+void scanner::pretokenize(int threads)
+// Lex the rest of the source into a token_stream; get_token() then steps through it. Errors found on the
+// way are held and reported as the parser reaches the token they were found in, so the output is the same
+// as scanning on demand. Token 0 of the stream stands for the current token, which is left as it is.
+{
+	time_report::phase_guard timing(time_report::scanner_phase);
+
+	// A streamed source is never all in memory, so it is scanned on demand.
+	if ((stream != NULL) or source->is_streamed())
+		return;
+
+	token_stream* lexed = new token_stream(source);
+	lexed->add(current_token->get_sym(), false, 0, 0);
+	int first_name_id = get_current_identifier_id();
+
+	// Parts are only worth a thread of their own if they are large, and they must start at the top of the file.
+	int parts = min<size_t>(threads, source->size() / min_part_bytes);
+	bool at_start = (line_number == 1) and (pos_on_line == -1);
+	if ((parts < 2) or !at_start or !lex_in_parallel(lexed, parts))
+		lex_into(lexed);
+
+	stream = lexed;
+	cursor = 0;
+	next_held_error = 0;
+	stream_name_id = first_name_id;
+}
+
+
+void scanner::lex_into(token_stream* lexed)
+// Scan every remaining token into lexed, ending with end_of_program, holding the errors found.
+{
+	vector<error_handler::held_error> held;
+	error->hold_errors(&held);
+	bool at_end;
+	do
+	{
+		at_end = !scan_token();
+		for (const error_handler::held_error& e : held)
+			lexed->hold_error(e);
+		held.clear();
+
+		if (at_end)
+			lexed->add(symbol::end_of_program, false, current_offset, 0);
+		else
+		{
+			// Anything spelled with letters records its name, so get_current_identifier_id() can be answered later.
+			symbol::symbol_type s = current_symbol.get_sym();
+			bool spelled = isalpha(source->begin()[current_offset]);
+			uint32_t payload = 0;
+			if (spelled)
+				payload = get_current_identifier_id();
+			else if (s == symbol::strng)
+				payload = tokens->add_string(current_string_value);
+			else if (s == symbol::integer)
+				memcpy(&payload, &current_integer_value, sizeof(payload));
+			else if (s == symbol::real_num)
+				memcpy(&payload, &current_real_value, sizeof(payload));
+			lexed->add(s, spelled, current_offset, payload);
+		}
+		if (pragma_skipped)
+			lexed->mark_after_pragma();
+		time_report::count(time_report::tokens_counter);
+	} while (!at_end);
+	error->hold_errors(NULL);
+}
+
+
+bool scanner::lex_in_parallel(token_stream* lexed, int parts)
+// Split the source into about the given number of parts, each starting at the beginning of a line. Strings
+// and comments end with their line, so each part can be lexed on a thread of its own, starting from the
+// same state. The parts are appended to lexed in order, translating their name IDs to this scanner's name
+// table. Only a pragma can carry on from one line to the next; if one runs off the end of a part, or a
+// part fails, nothing is appended and false is returned so the source can be lexed in one go instead.
+{
+	const char* begin = source->begin();
+	const char* end = source->end();
+	vector<lexed_part> part;
+	for (const char* from = begin; from < end; from = part.back().to)
+	{
+		const char* to = end;
+		if (part.size() + 1 < size_t(parts))
+		{
+			const char* target = max(from, begin + source->size() * (part.size() + 1) / parts);
+			const char* newline = (const char*) memchr(target, '\n', end - target);
+			if (newline != NULL)
+				to = newline + 1;
+		}
+		part.push_back({from, to, NULL, NULL, NULL, false, false});
+	}
+
+	vector<thread> workers;
+	for (lexed_part& p : part)
+		workers.emplace_back(lex_part, source, id_tab, &p);
+	for (thread& w : workers)
+		w.join();
+
+	bool redo = false;
+	for (size_t i = 0; i < part.size(); i++)
+		redo = redo or part[i].failed or (part[i].pragma_cut and (i + 1 < part.size()));
+
+	if (!redo)
+	{
+		// Interning each part's names in the order it first met them gives the IDs lexing in one go would have.
+		for (size_t i = 0; i < part.size(); i++)
+		{
+			vector<int> name_ids(part[i].names->size());
+			for (size_t id = 0; id < name_ids.size(); id++)
+				name_ids[id] = names->intern(part[i].names->name(id));
+			lexed->append(part[i].tokens, name_ids, part[i].strings, tokens, i + 1 == part.size());
+		}
+		time_report::count(time_report::tokens_counter, lexed->size() - 1);
+	}
+
+	for (lexed_part& p : part)
+	{
+		delete p.tokens;
+		delete p.strings;
+		delete p.names;
+	}
+	return !redo;
+}
+
+
+void scanner::lex_part(source_buffer* src, id_table* id_t, lexed_part* part)
+// Lex one part of src. Runs on a thread of its own; the name table and token pool made here only become
+// the active ones for this thread, and no time_report is active on it.
+{
+	part->names = new name_table();
+	error_handler* err = new error_handler(src);
+	scanner* scan = new scanner(src, part->names, id_t, err, part->from, part->to);
+	part->tokens = new token_stream();
+	try
+	{
+		scan->lex_into(part->tokens);
+	}
+	catch (lille_exception& e)
+	{
+		part->failed = true;		// lexing in one go will raise it again, in the right place
+	}
+	part->strings = scan->tokens;
+	part->pragma_cut = scan->pragma_at_end;
+	delete scan;
+	delete err;
+}
+
+
+scanner::token_range scanner::relex(uint32_t offset, uint32_t removed, const string& inserted)
+// The lines lexed again run from the line of the last token before the edit, so that a pragma between it
+// and the edit is lexed again whole, to the end of the line the inserted text ends on, or further while pragmas
+// carry on. A pragma that runs off the end of them takes the rest of the source with it.
+{
+	time_report::phase_guard timing(time_report::scanner_phase);
+	if (stream == NULL)
+		throw lille_exception("Only a pretokenized source can be lexed again after an edit.");
+
+	source_buffer* edited = new source_buffer(source, offset, removed, inserted);
+	int64_t shift = int64_t(inserted.size()) - removed;
+	const char* begin = edited->begin();
+	const char* end = edited->end();
+
+	// Token 0 stands for the token that was current when pretokenize() was called; it is never lexed again.
+	// Lexing a token that follows a pragma starts where the token before it ended, so the lines lexed
+	// again go back until their first token does not follow a pragma.
+	size_t first = stream->first_at(offset, 1);
+	const char* from = (first > 1) ? begin + stream->offset(first - 1) : begin + offset;
+	for (;;)
+	{
+		while ((from > begin) and (from[-1] != '\n'))
+			from--;
+		first = stream->first_at(from - begin, 1);
+		if (!stream->after_pragma(first) or (from == begin))
+			break;
+		from = (first > 1) ? begin + stream->offset(first - 1) : begin;
+	}
+
+	// Errors held for a token that follows a pragma were found lexing the pragma, so the lines lexed again
+	// go on until the token after them does not follow one.
+	const char* to = begin + offset + inserted.size();
+	for (;;)
+	{
+		const char* newline = (const char*) memchr(to, '\n', end - to);
+		to = (newline == NULL) ? end : newline + 1;
+		size_t next = stream->first_at((to - begin) - shift, first);
+		if ((to == end) or !stream->after_pragma(next))
+			break;
+		to = begin + stream->offset(next) + shift;
+	}
+
+	token_stream* part;
+	scanner* scan;
+	error_handler* err = new error_handler(edited);
+	for (;;)
+	{
+		part = new token_stream();
+		scan = new scanner(edited, names, id_tab, err, from, to);
+		scan->lex_into(part);
+		if (!scan->pragma_at_end or (to == end))
+			break;
+		delete scan->tokens;
+		delete scan;
+		delete part;
+		to = end;
+	}
+	size_t count = stream->first_at((to - begin) - shift, first) - first;
+
+	// Whole lines were lexed again, but usually only the tokens of the edit itself differ.
+	size_t added = part->size() - 1;
+	size_t same_before = 0;
+	while ((same_before < count) and (same_before < added)
+			and stream->same_token(first + same_before, part, same_before, 0, tokens, scan->tokens))
+		same_before++;
+	size_t same_after = 0;
+	while ((same_after < count - same_before) and (same_after < added - same_before)
+			and stream->same_token(first + count - 1 - same_after, part, added - 1 - same_after, shift, tokens, scan->tokens))
+		same_after++;
+
+	stream->splice(first, count, part, scan->tokens, tokens, shift);
+	delete scan->tokens;
+	delete scan;
+	delete part;
+	delete err;
+	tokens->make_current();
+
+	if (owns_source)
+		delete source;
+	source = edited;
+	owns_source = true;
+	error->set_source(edited);
+
+	// Start again from the first token.
+	cursor = 0;
+	next_held_error = 0;
+	stream_name_id = name_table::no_name;
+	current_token = NULL;
+	return { first + same_before, count - same_before - same_after, added - same_before - same_after };
+}
+
+
+void scanner::advance()
+// Step to the next token of the stream. The final end_of_program token repeats, as it does when scanning on demand.
+{
+	if (cursor + 1 < stream->size())
+		cursor++;
+	report_held_errors();
+}
+
+
+void scanner::report_held_errors()
+// Report the errors found while scanning the token at the cursor.
+{
+	while ((next_held_error < stream->error_count()) and (stream->error_token(next_held_error) <= cursor))
+	{
+		error_handler::held_error e = stream->error(next_held_error++);
+		error->flag(e.offset, e.err_no);
+	}
+	stream_name_id = stream->spelled(cursor) ? stream->name_id(cursor) : name_table::no_name;
+	current_token = NULL;			// built by this_token() if the parser asks for it
+}
+
+
 void scanner::scan_string()
 {
-        current_symbol = new symbol(symbol::strng);
+        current_symbol = symbol(symbol::strng);
 
         current_string_value = "";
         bool closed = false;
@@ -422,11 +772,11 @@ void scanner::scan_string()
 
          if (!closed)
          {
-             error->flag(current_line_number, current_pos_on_line, 60);
+             error->flag(current_offset, 60);
          }
          else if (current_string_value == "")
          {
-             error->flag(current_line_number, current_pos_on_line, 124);
+             error->flag(current_offset, 124);
          }
 
 }
@@ -434,256 +784,152 @@ void scanner::scan_string()
 void scanner::scan_alpha()
 {
 	// Scan in a token beginning with a letter
-	// *** TO BE COMPLETED ***
 	// This method takes care of reserved words and identifies in the language. These begin with a alphabetic character
 	// and contain an unlimited number of significant characters. Note that lower case letters are converted to upper case
 	// before being stored. For each identifier, a check is made to see if the identifier maps onto a reserved word.
 	// Make sure that there are no trailing underscores
+	// Reserved words are recognised from the raw bytes in the source buffer, before the name is built.
+	// The whole run of letters, digits and underscores is found, upper cased and checked for "__" in one pass.
 
 	bool malformed_ident {false};
-	current_identifier_name = "";
+	const char* start = line_start + pos_on_line;	// valid until get_char(), which may refill a streamed window
+
+	size_t room = (line_end - start) + simd_scan::vector_slack;
+	if (identifier_buffer.size() < room)
+		identifier_buffer.resize(room);
+	const char* end = simd_scan::scan_identifier(start, line_end, source->end() + 1, identifier_buffer.data(), malformed_ident);
+	int length = end - start;
+
+	if (malformed_ident or (start[length - 1] == '_'))
+		error->flag(current_offset, 61); 		// Illegal underscore in identifier.
+	else
+		current_symbol = symbol(symbol::keyword(start, length));	// identifier unless it spells a reserved word
 
-	current_identifier_name += char(toupper(next_char)); 	// in case it is an identifier, we need to record what the identifier actually is.
+	// Leave next_char on the character after the identifier, as reading it with get_char() would have.
+	pos_on_line = (end - line_start) - 1;
 	get_char();
-	while (isalpha(next_char) or isdigit(next_char) or (next_char == '_'))
-	{
-		if ((next_char == '_') and (following_char() == '_'))
-			malformed_ident = true;
-		current_identifier_name += char(toupper(next_char));
-		get_char();
-	}
-	if (malformed_ident or (current_identifier_name.at(current_identifier_name.length() - 1)) == '_')
-		error->flag(current_line_number, current_pos_on_line, 61); 		// Illegal underscore in identifier.
-	// check to see if the string matches an a reserved word
-	else if (current_identifier_name == "AND")
-		current_symbol = new symbol(symbol::and_sym);
-	else if (current_identifier_name == "BEGIN")
-		current_symbol = new symbol(symbol::begin_sym);
-	else if (current_identifier_name == "BOOLEAN")
-		current_symbol = new symbol(symbol::boolean_sym);
-	else if (current_identifier_name == "CONSTANT")
-		current_symbol = new symbol(symbol::constant_sym);
-	else if (current_identifier_name == "ELSE")
-		current_symbol = new symbol(symbol::else_sym);
-	else if (current_identifier_name == "ELSIF")
-		current_symbol = new symbol(symbol::elsif_sym);
-	else if (current_identifier_name == "END")
-		current_symbol = new symbol(symbol::end_sym);
-	else if (current_identifier_name == "EOF")
-		current_symbol = new symbol(symbol::eof_sym);
-	else if (current_identifier_name == "EXIT")
-		current_symbol = new symbol(symbol::exit_sym);
-	else if (current_identifier_name == "FALSE")
-		current_symbol = new symbol(symbol::false_sym);
-	else if (current_identifier_name == "FOR")
-		current_symbol = new symbol(symbol::for_sym);
-	else if (current_identifier_name == "FUNCTION")
-		current_symbol = new symbol(symbol::function_sym);
-	else if (current_identifier_name == "IF")
-		current_symbol = new symbol(symbol::if_sym);
-	else if (current_identifier_name == "IN")
-		current_symbol = new symbol(symbol::in_sym);
-	else if (current_identifier_name == "INTEGER")
-		current_symbol = new symbol(symbol::integer_sym);
-	else if (current_identifier_name == "IS")
-		current_symbol = new symbol(symbol::is_sym);
-	else if (current_identifier_name == "LOOP")
-		current_symbol = new symbol(symbol::loop_sym);
-	else if (current_identifier_name == "NOT")
-		current_symbol = new symbol(symbol::not_sym);
-	else if (current_identifier_name == "NULL")
-		current_symbol = new symbol(symbol::null_sym);
-	else if (current_identifier_name == "ODD")
-		current_symbol = new symbol(symbol::odd_sym);
-	else if (current_identifier_name == "OR")
-		current_symbol = new symbol(symbol::or_sym);
-	else if (current_identifier_name == "PRAGMA")
-		current_symbol = new symbol(symbol::pragma_sym);
-	else if (current_identifier_name == "PROCEDURE")
-		current_symbol = new symbol(symbol::procedure_sym);
-	else if (current_identifier_name == "PROGRAM")
-		current_symbol = new symbol(symbol::program_sym);
-	else if (current_identifier_name == "READ")
-		current_symbol = new symbol(symbol::read_sym);
-	else if (current_identifier_name == "REAL")
-		current_symbol = new symbol(symbol::real_sym);
-	else if (current_identifier_name == "REF")
-		current_symbol = new symbol(symbol::ref_sym);
-	else if (current_identifier_name == "RETURN")
-		current_symbol = new symbol(symbol::return_sym);
-	else if (current_identifier_name == "REVERSE")
-		current_symbol = new symbol(symbol::reverse_sym);
-	else if (current_identifier_name == "STRING")
-		current_symbol = new symbol(symbol::string_sym);
-	else if (current_identifier_name == "THEN")
-		current_symbol = new symbol(symbol::then_sym);
-	else if (current_identifier_name == "TRUE")
-		current_symbol = new symbol(symbol::true_sym);
-	else if (current_identifier_name == "VALUE")
-		current_symbol = new symbol(symbol::value_sym);
-	else if (current_identifier_name == "WHEN")
-		current_symbol = new symbol(symbol::when_sym);
-	else if (current_identifier_name == "WRITE")
-		current_symbol = new symbol(symbol::write_sym);
-	else if (current_identifier_name == "WRITELN")
-		current_symbol = new symbol(symbol::writeln_sym);
-	else if (current_identifier_name == "WHILE")
-		current_symbol = new symbol(symbol::while_sym);
+
+	// in case it is an identifier, we need to record what the identifier actually is.
+	current_identifier_name = string_view(identifier_buffer.data(), length);
+
+	// Identifiers are interned straight away since their token carries the ID. Anything else is only
+	// interned if the parser asks for its ID.
+	if (current_symbol.get_sym() == symbol::identifier)
+		current_identifier_id = names->intern(current_identifier_name.data(), current_identifier_name.size());
 	else
-		current_symbol = new symbol(symbol::identifier);
+		current_identifier_id = name_table::no_name;
 }
 
 void scanner::scan_digit()
 {
-        // scan in a token beginning with a digit
-        // Note that a unary operator such as -1 would be detected as a minus sign followed by a digit.
-
-        // TO BE COMPLETED BEFORE THE SCANNER FUNCTIONS PROPERLY AND THE
-        // PARSER CAN BE STARTED.
-
-        // INSERT CODE HERE.
-
-        string digit = ""; //string to hold the #
-        int frac_digits = 0; //Int to hold # of digits after the decimal
-        int exponent = 0; //Int to hold exponent for scientific notation
-        char sign = '+'; //Char to hold sign for scientific notation (default is positive)
-
-        while (isdigit(next_char))
-        {
-           digit += next_char;//Scans in the integer part of the #
-           get_char();
-        }
-
-        try
-        {
-           current_integer_value = stoi(digit); //Checks to see if # is to large to be stored
-        }
-        catch (...)
-        {
-           error->flag(current_line_number, current_pos_on_line, 62); //Error: # is too large to be stored
-        }
-
-        if((next_char == '.') and (following_char() != '.'))//Filtering out range symbols
-        {
-           //Checks if # is real, gets decimal then scans # after the decimal, checks to see if # is too large to be stored in a float and checks scientific notation and errors.
-
-          current_symbol = new symbol(symbol::real_num);
-          digit = "";
-          get_char(); //grabs the decimal
-
-          if (!isdigit(next_char)) //makes sure there isnt anything besides a number after a decimal
-          {
-             error->flag(current_line_number, current_pos_on_line, 63);
-          }
-          else
-          {
-           while(isdigit(next_char))
-           {
-             //scan in the fractional part of the number
-             digit += next_char;
-             frac_digits++;
-             get_char();
-           }
-           try
-           {
-             //check to see if the number is too large to be stored in a float
-             current_real_value = stof(digit);
-             current_real_value = float(current_integer_value) + (current_real_value / pow(10, frac_digits));
-           }
-           catch (...)
-           {
-             //error, real number must have digits after the decimal
-             error->flag(current_line_number, current_pos_on_line, 63);
-           }
-           }
-           if(next_char == 'E' or next_char == 'e')//For scientific notation
-           {
+	// Scan in a token beginning with a digit
+	// Note that a unary operator such as -1 would be detected as a minus sign followed by a digit.
+	// The extent of the number is found in the source buffer first, then its value is converted in place with
+	// from_chars, so reals are correctly rounded and nothing is allocated. Out of range values are flagged
+	// rather than thrown.
+
+	const char* start = line_start + pos_on_line;	// numbers never span lines, so the span stays valid
+	const char* p = start;
+	while ((p < line_end) and isdigit(*p))
+		p++;
+	const char* integer_end = p;
+
+	bool real = (p < line_end) and (*p == '.') and (p[1] != '.');	// a second '.' makes it a range, 1..5
+	bool fraction_ok = true;
+	if (real)
+	{
+		p++;		// the '.'
+		fraction_ok = (p < line_end) and isdigit(*p);
+		while ((p < line_end) and isdigit(*p))
+			p++;
+	}
+	const char* mantissa_end = p;
+
+	// Optional exponent: E or e, an optional sign, then digits.
+	bool has_exponent = (p < line_end) and ((*p == 'E') or (*p == 'e'));
+	bool negative_exponent = false;
+	bool exponent_ok = true;
+	int exponent = 0;
+	if (has_exponent)
+	{
+		p++;
+		if ((p < line_end) and ((*p == '+') or (*p == '-')))
+		{
+			negative_exponent = (*p == '-');
+			p++;
+		}
+		const char* exponent_start = p;
+		while ((p < line_end) and isdigit(*p))
+			p++;
+		if (p == exponent_start)
+		{
+			error->flag(current_offset, 64);		// Must have digits after exponent symbol.
+			has_exponent = false;
+		}
+		else if (from_chars(exponent_start, p, exponent).ec != errc())
+		{
+			error->flag(current_offset, 65);		// Too many digits in the exponent.
+			exponent_ok = false;
+		}
+	}
 
-              digit = "";
-              get_char(); //grabs the E
-              sign = next_char;
-
-              // possitive or negative exponent
-              if(sign == '-' or sign == '+')
-                        get_char(); //grabs the sign
-
-                 if(!isdigit(next_char))  //cant have scientific notation that contains anything besides numbers (or +/-)
-                        error->flag(current_line_number, current_pos_on_line, 64);
-
-                        while(isdigit(next_char))
-                        { //grabs all the numbers from the scientific notation
-                                digit += next_char;
-                                get_char();
-                        }
-                        try
-                        {
-                                // check to see if the number is too large to be stored in a integer
-                                exponent = stoi(digit);
-                        }
-                        catch (...)
-                        {
-                                error->flag(current_line_number, current_pos_on_line, 65);
-                        }
-                        try
-                        {
-                                if(sign == '-')
-                                        current_real_value /= float(pow(10, exponent)); //negative exponent
-                                else
-                                        current_real_value *= float(pow(10, exponent)); //positive exponent
-                        }
-                        catch (...)
-                        {
-                                error->flag(current_line_number, current_pos_on_line, 66);
-                        }
-                }
-        }
-        else
-        {
-                // Already have the integer part of the #
-                // check for scientific notation and check errors
-
-                current_symbol = new symbol(symbol::integer);
-                digit = "";
-
-                if(next_char == 'E' or next_char == 'e')//scientific notation
-                {
-                   get_char(); //grabs the E
-                   sign = next_char;
-                        if(sign == '-' or sign == '+')
-                                get_char(); //grabs the sign
-
-                        if(!isdigit(next_char))
-                        {  //cant have scientific notation that contains anything besides numbers (or +/-)
-                                error->flag(current_line_number, current_pos_on_line, 64);
-                        }
-                        while(isdigit(next_char))
-                        { //grabs all the numbers from the scientific notation
-                                digit += next_char;
-                                get_char();
-                        }
-                        try
-                        {
-                                // check to see if the number is too large to be stored in a integer
-                                exponent = stoi(digit);
-                        }
-                        catch (...)
-                        {
-                                error->flag(current_line_number, current_pos_on_line, 65);
-                        }
-                        try
-                        {
-                                if (sign == '-')
-                                        current_integer_value /= int(pow(10, exponent));
-                                else
-                                        current_integer_value *= int(pow(10, exponent));
-                        }
-                        catch (...)
-                        {
-                                error->flag(current_line_number, current_pos_on_line, 66);
-                        }
-                }
-        }
+	if (real)
+	{
+		current_symbol = symbol(symbol::real_num);
+		current_real_value = 0.0;
+		if (!fraction_ok)
+		{
+			error->flag(current_offset, 63);		// Real number must have digits after the dot/period.
+			from_chars(start, integer_end, current_real_value);
+		}
+		else if (exponent_ok)
+		{
+			// Convert the digits and exponent together; the exponent is left out if it had no digits.
+			from_chars_result r = from_chars(start, has_exponent ? p : mantissa_end, current_real_value);
+			if (r.ec == errc::result_out_of_range)
+			{
+				// Out of range either way; the power of ten of the leading digit says which way. The mantissa is
+				// not all zeros, or it would have converted.
+				const char* lead = start;
+				while ((*lead == '0') or (*lead == '.'))
+					lead++;
+				long long magnitude = (lead < integer_end) ? integer_end - lead - 1 : integer_end - lead;
+				magnitude += negative_exponent ? -(long long)exponent : exponent;
+				if (magnitude < 0)
+					current_real_value = 0.0;										// too small to represent
+				else
+					error->flag(current_offset, 66);	// Floating point number too large.
+			}
+		}
+	}
+	else
+	{
+		current_symbol = symbol(symbol::integer);
+		current_integer_value = 0;
+		if (from_chars(start, integer_end, current_integer_value).ec != errc())
+			error->flag(current_offset, 62);			// Number too large.
+		else if (has_exponent and exponent_ok)
+		{
+			if (negative_exponent)
+				error->flag(current_offset, 67);		// An integer can only have a positive exponent.
+			else
+			{
+				for (int i = 0; (i < exponent) and (current_integer_value != 0); i++)
+				{
+					if (__builtin_mul_overflow(current_integer_value, 10, &current_integer_value))
+					{
+						error->flag(current_offset, 62);	// Number too large.
+						current_integer_value = 0;
+						break;
+					}
+				}
+			}
+		}
+	}
 
+	// Leave next_char on the character after the number, as reading it with get_char() would have.
+	pos_on_line = (p - line_start) - 1;
+	get_char();
 }
 
 void scanner::scan_special_symbol()
@@ -694,94 +940,95 @@ void scanner::scan_special_symbol()
 	case ':':	// BECOMES or a COLON
 		if (following_char() == '=')
 		{
-			current_symbol = new symbol(symbol::becomes_sym);
+			current_symbol = symbol(symbol::becomes_sym);
 			get_char();
 		}
 		else
-			current_symbol = new symbol(symbol::colon_sym);
+			current_symbol = symbol(symbol::colon_sym);
 		break;
 	case '<':	// LESS THAN, LESS OR EQUAL, or NOT EQUAL
 		if (following_char() == '=')
 		{
-			current_symbol = new symbol(symbol::less_or_equal_sym);
+			current_symbol = symbol(symbol::less_or_equal_sym);
 			get_char();
 		}
 		else if (following_char() == '>')
 		{
-			current_symbol = new symbol(symbol::not_equals_sym);
+			current_symbol = symbol(symbol::not_equals_sym);
 			get_char();
 		}
 		else
-			current_symbol = new symbol(symbol::less_than_sym);
+			current_symbol = symbol(symbol::less_than_sym);
 		break;
 	case '>':	// GREATER THAN, or GREATER OR EQUAL
 		if (following_char() == '=')
 		{
-			current_symbol = new symbol(symbol::greater_or_equal_sym);
+			current_symbol = symbol(symbol::greater_or_equal_sym);
 			get_char();
 		}
 		else
-			current_symbol = new symbol(symbol::greater_than_sym);
+			current_symbol = symbol(symbol::greater_than_sym);
 		break;
 	case '*':	// ASTERISK or POWER symbol
 		if (following_char() == '*')
 		{
-			current_symbol = new symbol(symbol::power_sym);
+			current_symbol = symbol(symbol::power_sym);
 			get_char();
 		}
 		else
-			current_symbol = new symbol(symbol::asterisk_sym);
+			current_symbol = symbol(symbol::asterisk_sym);
 		break;
 	case '.':	// RANGE symbol
 		if (following_char() == '.')
 		{
-			current_symbol = new symbol(symbol::range_sym);
+			current_symbol = symbol(symbol::range_sym);
 			get_char();
 		}
 		else if(isdigit(following_char()))
 		{
 			scan_digit();
+			return;		// next_char is already the character after the number
 		}
 		else 
 		{
 			// illegal symbol
-			current_symbol = new symbol(symbol::nul);
-			error->flag(current_line_number, current_pos_on_line, 22);	// Expected a range token.
+			current_symbol = symbol(symbol::nul);
+			error->flag(current_offset, 22);	// Expected a range token.
 		}
 		break;
 	case '"':	// Start of a string
 		scan_string();
 		break;
 	case '&':
-		current_symbol = new symbol(symbol::ampersand_sym);
+		current_symbol = symbol(symbol::ampersand_sym);
 		break;
 	case '/':
-		current_symbol = new symbol(symbol::slash_sym);
+		current_symbol = symbol(symbol::slash_sym);
 		break;
 	case ';':
-		current_symbol = new symbol(symbol::semicolon_sym);
+		current_symbol = symbol(symbol::semicolon_sym);
 		break;
 	case '(':
-		current_symbol = new symbol(symbol::left_paren_sym);
+		current_symbol = symbol(symbol::left_paren_sym);
 		break;
 	case ')':
-		current_symbol = new symbol(symbol::right_paren_sym);
+		current_symbol = symbol(symbol::right_paren_sym);
 		break;
 	case ',':
-		current_symbol = new symbol(symbol::comma_sym);
+		current_symbol = symbol(symbol::comma_sym);
 		break;
 	case '+':
-		current_symbol = new symbol(symbol::plus_sym);
+		current_symbol = symbol(symbol::plus_sym);
 		break;
 	case '-':
-		current_symbol = new symbol(symbol::minus_sym);
+		current_symbol = symbol(symbol::minus_sym);
 		break;
 	case '=':
-		current_symbol = new symbol(symbol::equals_sym);
+		current_symbol = symbol(symbol::equals_sym);
 		break;
 	default:
-		current_symbol = new symbol(symbol::nul);
-		error->flag(current_line_number, current_pos_on_line, 74); 	// illegal character.
+		current_symbol = symbol(symbol::nul);
+		error->flag(current_offset, 74); 	// illegal character.
 		break;
 	}
 	get_char();	// get the next character
@@ -799,81 +1046,83 @@ void scanner::parse_pragma()
     
 	string pragma_name = "";
 
-	get_token();	// consume the pragma keyword
-	if (current_symbol->get_sym() == symbol::identifier)
+	scan_token();	// consume the pragma keyword
+	if (current_symbol.get_sym() == symbol::identifier)
 	{
 		pragma_name = current_identifier_name;;
 		if ((pragma_name != "ERROR_LIMIT")
 				and (pragma_name != "TRACE")
 				and (pragma_name != "UNTRACE")
 				and (pragma_name != "DEBUG"))
-			error->flag(current_line_number, current_pos_on_line, 70);		// Illegal pragma name
+			error->flag(current_offset, 70);		// Illegal pragma name
 	}
 	else
-		error->flag(current_line_number, current_pos_on_line, 69);  	// Malformed pragma.
-	get_token();	// consume pragma name
+		error->flag(current_offset, 69);  	// Malformed pragma.
+	scan_token();	// consume pragma name
 	// check to see if arguments are provided to the pragma
-	if (current_symbol->get_sym() == symbol::left_paren_sym)
-		get_token();	// consume left paren
+	if (current_symbol.get_sym() == symbol::left_paren_sym)
+		scan_token();	// consume left paren
 		// C++ does not support the use of a switch statement on strings.
 	else
-		error->flag(current_line_number, current_pos_on_line, 20);	// pragmas have arguments so a left paren is expected.
+		error->flag(current_offset, 20);	// pragmas have arguments so a left paren is expected.
 
 	if (pragma_name == "ERROR_LIMIT")
 	{
-		if (current_symbol->get_sym() == symbol::integer)
+		if (current_symbol.get_sym() == symbol::integer)
         {
 			// INSERT CODE HERE
         }
 		else
-			error->flag(current_line_number, current_pos_on_line, 71);	// pragma ERROR_LIMIT requires a numeric argument.
+			error->flag(current_offset, 71);	// pragma ERROR_LIMIT requires a numeric argument.
 	}
 	else if (pragma_name == "TRACE")
 	{
-		if (current_symbol->get_sym() == symbol::identifier)
+		if (current_symbol.get_sym() == symbol::identifier)
 			// Turn on tracing flag in the symbol table for this identifier.
 			// Do not generate an error if the identifier is not present!
 		{
             // INSERT CODE HERE
 		}
 		else
-			error->flag(current_line_number, current_pos_on_line, 72);	// pragma TRACE requires a variable name.
+			error->flag(current_offset, 72);	// pragma TRACE requires a variable name.
 	}
 	else if (pragma_name == "UNTRACE")
 	{
-		if (current_symbol->get_sym() == symbol::identifier)
+		if (current_symbol.get_sym() == symbol::identifier)
             // Turn off tracing flag in the symbol table for this identifier.
             // Do not generate an error if the identifier is not present!
         {
             // INSERT CODE HERE
         }
 		else
-			error->flag(current_line_number, current_pos_on_line, 72);	// pragma UNTRACE requires a variable name.
+			error->flag(current_offset, 72);	// pragma UNTRACE requires a variable name.
 	}
 	else if (pragma_name == "DEBUG")
 	{
-		if (current_symbol->get_sym() == symbol::identifier)
+		if (current_symbol.get_sym() == symbol::identifier)
 		{
 			// INSERT CODE HERE
             // pragma DEBUG requires either ON or OFF as the argument.
 		}
 		else
-			error->flag(current_line_number, current_pos_on_line, 72);	// pragma TRACE requires a variable name.
+			error->flag(current_offset, 72);	// pragma TRACE requires a variable name.
 	}
 	else
 	{
 		// Already generated an error message about an illegal pragma name
 	}
-	get_token();	// consume the argument
-	if (current_symbol->get_sym() == symbol:: right_paren_sym)
-		get_token();		// consume right paren
+	scan_token();	// consume the argument
+	if (current_symbol.get_sym() == symbol:: right_paren_sym)
+		scan_token();		// consume right paren
 	else
-		error->flag(current_line_number, current_pos_on_line, 21);	// Right paren expected
-	if (current_symbol->get_sym() == symbol::semicolon_sym)
-			get_token();		// consume semicolon
+		error->flag(current_offset, 21);	// Right paren expected
+	if (current_symbol.get_sym() == symbol::semicolon_sym)
+			scan_token();		// consume semicolon
 	else
-		error->flag(current_line_number, current_pos_on_line, 5);	// semicolon expected
+		error->flag(current_offset, 5);	// semicolon expected
 
+	if (eof_flag)
+		pragma_at_end = true;		// lexing part of a source, the pragma may carry on in the next part
 }
 
 
@@ -881,49 +1130,83 @@ void scanner::parse_pragma()
 bool scanner::have(symbol::symbol_type s)
 // Returns true if the current token is an s symbol, false otherwise.
 {
-	if (current_token->get_sym() == s)
-		return true;
+	if (stream != NULL)
+		return stream->kind(cursor) == s;
 	else
-		return false;
+		return current_token->get_sym() == s;
+}
+
+bool scanner::have(const symbol_set& s)
+{
+	if (stream != NULL)
+		return s.contains(stream->kind(cursor));
+	else
+		return s.contains(current_token->get_sym());
 }
 
 void scanner::must_be(symbol::symbol_type s)
 // The current token must be an s symbol otherwise it is a syntax error. If the current token matches
 // the symbol s, then the scanner discards the token and advances to the next token in the source file.
 {
-	if(error->recovery()) {
-		while(current_token->get_sym() != s and current_token->get_sym() != symbol::end_of_program) 
-			get_token();
-		if(s == current_token->get_sym())
+	if (!have(s))
+	{
+		error->syntax(s, this_token(), error_message(s));		// reported unless already recovering
+		while (!have(s) and !have(sync) and !have(symbol::end_of_program))
 			get_token();
-		error->stopRecovery();
+		if (!have(s))
+			return;			// still recovering; the production being parsed carries on from this symbol
 	}
-	else if (current_token->get_sym() == s) 
-		get_token();
-	else 
-		error->syntax(s, current_token, error_message(s));
+	get_token();
+	error->stopRecovery();
 }
 
 
 token* scanner::this_token()
 // Returns the current token, without advancing to the next token in the input stream.
 {
-	token* result = new token();
-	result = current_token;
-	return result;
+	if (current_token == NULL)
+	{
+		stream_token = stream->make_token(cursor);
+		current_token = &stream_token;
+	}
+	return current_token;
+}
+
+uint32_t scanner::this_offset()
+{
+	if (stream != NULL)
+		return stream->offset(cursor);
+	return current_offset;
+}
+
+symbol::symbol_type scanner::this_symbol()
+{
+	if (stream != NULL)
+		return stream->kind(cursor);
+	return current_token->get_sym();
 }
 
 void scanner::print_current_token() {
-	cout << current_token->get_sym() << endl;
+	cout << this_token()->get_sym() << endl;
 }
 
 string scanner::get_current_identifier_name() {
-	string s = current_identifier_name;
-	transform(s.begin(), s.end(), s.begin(), ::toupper);
-	return s;
+	if (stream != NULL)
+		return (stream_name_id == name_table::no_name) ? "" : names->name(stream_name_id);
+	return string(current_identifier_name);		// already upper case
+}
+
+int scanner::get_current_identifier_id() {
+	if (stream != NULL)
+		return stream_name_id;
+	if (current_identifier_name.empty())
+		return name_table::no_name;
+	if (current_identifier_id == name_table::no_name)
+		current_identifier_id = names->intern(current_identifier_name.data(), current_identifier_name.size());
+	return current_identifier_id;
 }
 
 string scanner::get_current_sym() {
-	return current_symbol->symtostr();
+	return current_symbol.symtostr();
 	//cout << "TOKEN: " << sym->symtostr();
 }
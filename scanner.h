@@ -4,11 +4,17 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "symbol.h"
 #include "token.h"
 #include "error_handler.h"
 #include "id_table.h"
+#include "source_buffer.h"
+#include "token_pool.h"
+#include "name_table.h"
+#include "token_stream.h"
 
 using namespace std;
 
@@ -18,25 +24,66 @@ private:
 
 	const char end_marker = char(7);	// BELL character. Not typically in the source file and it is a control character < SPACE
 	token* current_token;
-	ifstream source_file;			// Source file to be compiled.
+	token_pool* tokens;				// Every token returned by the scanner is allocated from this pool.
+	source_buffer* source;			// Source file to be compiled, mapped into memory.
 	error_handler* error;			// Error handler for the scanner.
 	id_table* id_tab;
+	name_table* names;				// Every identifier is interned here, shared with the id_table.
 
 	int pos_on_line;				// position on current line
 	int line_number;				// current line number
 	bool eoln_flag;					// flag to indicate of whole string (line) has been processed
 
-	string input_buffer;			// line from source file that is currently being processed
+	const char* line_start;			// first character of the line that is currently being processed
+	const char* line_end;			// '\n' or sentinel terminating the current line; always safe to read
+	const char* unread;				// start of the next line in the source buffer
+	bool last_line_read;			// the final line (one with no terminating '\n') has been handed out
+	const char* text_end;			// where the text being scanned ends: the '\n' ending the last line of a part
+									// lexed on its own, or NULL for the end of the source
 	char next_char;					// next character to be processed
 
-	symbol* current_symbol;
-	int current_line_number;		// current line number of the start of the token we are handling
-	int current_pos_on_line;		// position on line of the start of the token we are handling
+	symbol current_symbol;
 	int current_integer_value;		// value if the token is an integer value
 	float current_real_value;		// value if the token is a floating point number.
 	string current_string_value;
-	string current_identifier_name;
-
+	string_view current_identifier_name;	// upper case name of the current token if it is an identifier or
+										// reserved word, held in identifier_buffer; empty for any other token
+	vector<char> identifier_buffer;	// upper cased copy of the last identifier; reused, so it only grows to the longest line
+	int current_identifier_id;		// name_table ID of current_identifier_name, or no_name until it is needed
+	uint32_t current_offset;		// byte offset in the source of the start of the token we are handling; its line
+									// and position are only worked out if it is reported
+
+	token_stream* stream;			// Every token of the source, if pretokenize() was called; otherwise NULL and
+									// tokens are scanned as the parser asks for them.
+	size_t cursor;					// Index in stream of the current token.
+	size_t next_held_error;			// First error held in stream that has not been reported yet.
+	int stream_name_id;				// Name ID of the token at the cursor if it is spelled with letters, else no_name.
+	token stream_token;				// The current token of the stream, once this_token() has built it.
+	bool pragma_at_end;				// A pragma ran to the end of the text, so it may carry on past the end of a part.
+	bool pragma_skipped;			// A pragma was acted on while finding the current token.
+	bool owns_source;				// Source was made by relex(), so is deleted when replaced.
+	symbol_set sync;				// Symbols error recovery stops at, for the productions being parsed.
+
+	static const size_t min_part_bytes = 1 << 20;	// Smallest part of a source worth lexing on a thread of its own.
+
+	struct lexed_part {				// Part of the source lexed on a thread of its own.
+		const char* from;			// Start of the first line of the part.
+		const char* to;				// One past the '\n' ending its last line, or the end of the source.
+		token_stream* tokens;
+		name_table* names;			// Names of the part, with IDs of its own.
+		token_pool* strings;		// String payloads of the part.
+		bool pragma_cut;			// A pragma ran to the end of the part.
+		bool failed;				// Lexing the part raised an exception.
+	};
+
+	scanner(source_buffer* src, name_table* n, id_table* id_t, error_handler* e, const char* from, const char* to);
+									// scan just the lines from from up to to
+	bool scan_token();				// find the next token, leaving it in the current_ variables; false at end of file
+	void lex_into(token_stream* lexed);	// scan every remaining token into lexed
+	bool lex_in_parallel(token_stream* lexed, int parts);	// lex the source in parts on several threads
+	static void lex_part(source_buffer* src, id_table* id_t, lexed_part* part);	// lex one part, on its own thread
+	void advance();					// step to the next token of the stream
+	void report_held_errors();		// report the errors the stream holds for the current token
 	void scan_string();				// scan in a string
 	void scan_alpha();				// scan in a token beginning with a letter
 	void scan_digit();				// scan in a token beginning with a digit
@@ -44,8 +91,9 @@ private:
 	void parse_pragma();			// parse the pragma identified by the scanner.
 
 	scanner();						// default constructor for the scanner.
-	void get_line();				// Get a line from the source file and store in the input buffer.
-	void get_char();				// get the next character from the input_buffer
+	void get_line();				// Advance line_start/line_end to the next line of the source buffer.
+	void get_char();				// get the next character from the current line
+	void skip_blanks();				// get the next character that is not blank, moving to the next line if need be
 	char following_char();			// peek at the next character on the line. Helpful for dealing with compound symbols such as :=
 	void fill_buffer();				// Call get_line() and set next_char
 
@@ -55,8 +103,10 @@ public:
     bool eof_flag;
     // Boolean flag to indicate if scanner has reached eof marker.
 
-    scanner(string source_file, id_table* id_t, error_handler* e);
-    // Opens the specified source file to read tokens from.
+    scanner(source_buffer* src, name_table* n, id_table* id_t, error_handler* e);
+    // Scans the source file held in src. The buffer is shared with the error handler so the listing
+    // can be produced without reading the file a second time.
+    // N is the name table identifiers are interned into; the id_table must use the same one.
     // Id_t is the identifier table for the compiler. It is only used by the scanner to implement the behavior
     // of pragmas.
     // E is the error handler for the scanner to use.
@@ -65,19 +115,75 @@ public:
     // Gets the next token from the input stream and returns it. The token is held in the private variable
     // current_token which is returned by the function this_token() if requested by the parser.
 
+    void pretokenize(int threads = 1);
+    // Scans the rest of the source up front into a token_stream, so get_token() and have() only step
+    // through arrays. Errors and results are the same as scanning on demand. Call it before the first
+    // get_token(). Does nothing for streamed sources.
+    // With threads > 1, a large source is split into that many parts at line boundaries, which are
+    // lexed at the same time.
+
+    struct token_range {			// The tokens an edit changed.
+        size_t first;				// Index of the first token that changed.
+        size_t removed;				// Tokens from first on that were replaced,
+        size_t inserted;			// and the number that replaced them. Later tokens moved inserted - removed on.
+    };
+
+    token_range relex(uint32_t offset, uint32_t removed, const string& inserted);
+    // Edits the source of a pretokenized scanner, replacing removed bytes from offset on by inserted, and
+    // brings its tokens up to date. Lexing only depends on the line being scanned, so just the lines the edit
+    // touches are lexed again and spliced into the stream; later tokens only move. Returns the range of
+    // tokens that differ. The scanner then starts again from the first token, so the edited source can be
+    // parsed again. Pretokenize() must have been called before the first get_token(), as the compiler does.
+    // The compiler's -edits flag calls it for each edit of a script an editor writes.
+
     bool have(symbol::symbol_type s);
     // Returns true if the current token is an s symbol, false otherwise.
 
+    bool have(const symbol_set& s);
+    // Returns true if the current token is any of the symbols in s, with one test.
+
     void must_be(symbol::symbol_type s);
     // The current token must be an s symbol otherwise it is a syntax error. If the current token matches
     // the symbol s, then the scanner discards the token and advances to the next token in the source file.
+    // Otherwise tokens are skipped until an s, which ends recovery, or a symbol of the current
+    // synchronisation set, where the production being parsed carries on. Only the first error is reported until
+    // recovery ends. Tokens are only ever skipped forward, so recovery costs no more than the tokens it skips.
+
+    class sync_guard {
+    // Makes symbols the synchronisation set while a production is parsed, then restores the set of the
+    // production around it when the guard goes out of scope. Recovery resumes in the innermost production,
+    // so a symbol only the production around it could use is skipped rather than closing it early.
+    private:
+        scanner* scan;
+        symbol_set previous;
+    public:
+        sync_guard(scanner* s, const symbol_set& symbols) : scan(s), previous(s->sync)
+        {
+            scan->sync = symbols;
+        }
+        ~sync_guard()
+        {
+            scan->sync = previous;
+        }
+    };
 
     token* this_token();
     // Returns the current token, without advancing to the next token in the input stream.
 
+    uint32_t this_offset();
+    // Byte offset in the source of the current token, without building the token.
+
+    symbol::symbol_type this_symbol();
+    // Symbol of the current token, without building the token.
+
 	void print_current_token();
 
 	string get_current_identifier_name();
+	// Upper case spelling of the current token, if it is spelled with letters; "" otherwise. Tokens inside a
+	// pragma are never current, so scanning on demand and a pretokenized stream give the same answer.
+
+	int get_current_identifier_id();
+	// Name table ID of the current token, if it is spelled with letters; no_name otherwise.
 
 	string get_current_sym();
 };
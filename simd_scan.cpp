@@ -0,0 +1,200 @@
+#include <string>
+#include <cctype>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_SCAN_X86 1
+#endif
+
+#include "simd_scan.h"
+
+using namespace std;
+
+
+static const char* skip_blanks_portable(const char* p, const char* line_end, const char*)
+{
+	while ((p < line_end) and (*p <= ' '))
+		p++;
+	return p;
+}
+
+
+static const char* scan_identifier_portable(const char* p, const char* line_end, const char*,
+		char* folded, bool& double_underscore)
+{
+	double_underscore = false;
+	bool underscore = false;		// previous character was '_'
+	while ((p < line_end) and (isalnum((unsigned char) *p) or (*p == '_')))
+	{
+		if (*p == '_')
+		{
+			if (underscore)
+				double_underscore = true;
+			underscore = true;
+		}
+		else
+			underscore = false;
+		*folded++ = toupper((unsigned char) *p);
+		p++;
+	}
+	return p;
+}
+
+
+#ifdef SIMD_SCAN_X86
+
+static inline __m128i in_range(__m128i v, char low, char high)
+// Lanes holding low..high. Signed compares, so bytes with the top bit set are never in range.
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(low - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), v));
+}
+
+
+static const char* scan_identifier_sse2(const char* p, const char* line_end, const char* readable_end,
+		char* folded, bool& double_underscore)
+// Classify 16 bytes at a time as letter, digit or underscore, and fold lower case letters by clearing their
+// 0x20 bit in the same pass. "__" shows up as two adjacent bits in the underscore mask.
+{
+	unsigned carry = 0;				// 1 if the last byte of the previous vector was '_'
+	unsigned doubles = 0;
+	while (p + 16 <= readable_end)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*) p);
+		__m128i lower = in_range(chunk, 'a', 'z');
+		__m128i underscore = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+		__m128i word = _mm_or_si128(_mm_or_si128(lower, in_range(chunk, 'A', 'Z')),
+				_mm_or_si128(in_range(chunk, '0', '9'), underscore));
+		_mm_storeu_si128((__m128i*) folded, _mm_sub_epi8(chunk, _mm_and_si128(lower, _mm_set1_epi8(0x20))));
+
+		unsigned word_mask = _mm_movemask_epi8(word);
+		unsigned run = __builtin_ctz(~word_mask);		// bytes of this vector that continue the identifier
+		if (p + run > line_end)
+			run = line_end - p;
+		unsigned run_mask = (1u << run) - 1;
+		unsigned underscores = ((_mm_movemask_epi8(underscore) << 1) | carry) & ((run_mask << 1) | 1);
+		doubles |= underscores & (underscores >> 1);
+		p += run;
+		folded += run;
+		if ((run < 16) or (p == line_end))
+		{
+			double_underscore = (doubles != 0);
+			return p;
+		}
+		carry = (underscores >> 16) & 1;
+	}
+
+	// Too close to the end of the buffer for a whole vector.
+	bool rest_double;
+	const char* end = scan_identifier_portable(p, line_end, readable_end, folded, rest_double);
+	double_underscore = (doubles != 0) or rest_double or ((carry != 0) and (end > p) and (*p == '_'));
+	return end;
+}
+
+
+static const char* skip_blanks_sse2(const char* p, const char* line_end, const char* readable_end)
+// Compare 16 bytes at a time against ' '. The compare is signed, matching the scalar test on a signed char.
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	while ((p < line_end) and (p + 16 <= readable_end))
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*) p);
+		unsigned mask = _mm_movemask_epi8(_mm_cmpgt_epi8(chunk, space));
+		if (mask != 0)
+		{
+			const char* found = p + __builtin_ctz(mask);
+			return (found < line_end) ? found : line_end;
+		}
+		p += 16;
+	}
+	return (p < line_end) ? skip_blanks_portable(p, line_end, readable_end) : line_end;
+}
+
+
+__attribute__((target("avx2")))
+static const char* skip_blanks_avx2(const char* p, const char* line_end, const char* readable_end)
+// As skip_blanks_sse2, 32 bytes at a time. Compiled for AVX2 only in this function, so the rest of the
+// compiler still runs on any x86-64.
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	while ((p < line_end) and (p + 32 <= readable_end))
+	{
+		__m256i chunk = _mm256_loadu_si256((const __m256i*) p);
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(chunk, space));
+		if (mask != 0)
+		{
+			const char* found = p + __builtin_ctz(mask);
+			return (found < line_end) ? found : line_end;
+		}
+		p += 32;
+	}
+	return (p < line_end) ? skip_blanks_sse2(p, line_end, readable_end) : line_end;
+}
+
+#endif
+
+
+simd_scan::level simd_scan::detect()
+{
+#ifdef SIMD_SCAN_X86
+	__builtin_cpu_init();		// may run before the runtime has initialised the CPU model during static initialisation
+	if (__builtin_cpu_supports("avx2"))
+		return avx2;
+	return sse2;
+#else
+	return portable;
+#endif
+}
+
+
+void simd_scan::select(level l)
+{
+	active = l;
+	switch (l)
+	{
+#ifdef SIMD_SCAN_X86
+	case avx2:
+		skipper = skip_blanks_avx2;
+		identifier_scanner = scan_identifier_sse2;		// identifiers are rarely longer than 16 characters
+		break;
+	case sse2:
+		skipper = skip_blanks_sse2;
+		identifier_scanner = scan_identifier_sse2;
+		break;
+#endif
+	default:
+		active = portable;
+		skipper = skip_blanks_portable;
+		identifier_scanner = scan_identifier_portable;
+	}
+}
+
+
+simd_scan::level simd_scan::active = simd_scan::portable;
+simd_scan::skip_function simd_scan::skipper = skip_blanks_portable;
+simd_scan::identifier_function simd_scan::identifier_scanner = scan_identifier_portable;
+
+static const bool selected = (simd_scan::use_level(simd_scan::avx2), true);		// pick the best level at start up
+
+
+simd_scan::level simd_scan::active_level()
+{
+	return active;
+}
+
+
+void simd_scan::use_level(level l)
+{
+	level best = detect();
+	select((l > best) ? best : l);
+}
+
+
+string simd_scan::level_name(level l)
+{
+	switch (l)
+	{
+	case avx2:		return "avx2";
+	case sse2:		return "sse2";
+	default:		return "portable";
+	}
+}
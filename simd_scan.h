@@ -0,0 +1,58 @@
+#ifndef SIMD_SCAN_H_
+#define SIMD_SCAN_H_
+
+#include <string>
+
+using namespace std;
+
+class simd_scan {
+public:
+	enum level {
+		portable,		// one byte at a time; used on machines without x86 vector units
+		sse2,			// 16 bytes at a time; always available on x86-64
+		avx2			// 32 bytes at a time, if the CPU supports it
+	};
+
+private:
+	typedef const char* (*skip_function)(const char* p, const char* line_end, const char* readable_end);
+	typedef const char* (*identifier_function)(const char* p, const char* line_end, const char* readable_end,
+			char* folded, bool& double_underscore);
+
+	static level active;				// Fastest level the CPU supports, unless overridden by use_level().
+	static skip_function skipper;		// Implementation of skip_blanks() for the active level.
+	static identifier_function identifier_scanner;	// Implementation of scan_identifier() for the active level.
+
+	static level detect();
+	static void select(level l);
+
+public:
+	static const char* skip_blanks(const char* p, const char* line_end, const char* readable_end)
+	// Returns the first character in [p, line_end) that is not blank, or line_end if the rest of the line is
+	// blank. As in the scanner, a blank is any char whose signed value is <= ' ', which includes control
+	// characters and bytes with the top bit set. Memory up to readable_end may be read, even past line_end,
+	// so the vector paths can load whole vectors near the end of a line.
+	{
+		return skipper(p, line_end, readable_end);
+	}
+
+	static const char* scan_identifier(const char* p, const char* line_end, const char* readable_end,
+			char* folded, bool& double_underscore)
+	// Returns the end of the run of letters, digits and underscores starting at p, stopping at line_end.
+	// The run is copied to folded with ASCII letters in upper case; folded must have room for the run plus
+	// vector_slack bytes, since whole vectors are stored. Double_underscore is set if the run contains "__".
+	{
+		return identifier_scanner(p, line_end, readable_end, folded, double_underscore);
+	}
+
+	static const int vector_slack = 32;	// Bytes a vector path may store past the end of its output.
+
+	static level active_level();
+	// Level selected for this machine.
+
+	static void use_level(level l);
+	// Force the given level, for benchmarking. Levels the CPU does not support fall back to the best one it does.
+
+	static string level_name(level l);
+};
+
+#endif /* SIMD_SCAN_H_ */
@@ -0,0 +1,312 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "source_buffer.h"
+#include "lille_exception.h"
+
+using namespace std;
+
+thread_local source_buffer* source_buffer::active = NULL;
+
+
+source_buffer::source_buffer()
+{
+	filename = "";
+	text = NULL;
+	length = 0;
+	mapped_length = 0;
+	heap_copy = NULL;
+	stream_fd = -1;
+	window_capacity = 0;
+	stream_ended = false;
+	stream_unread = NULL;
+	stream_discarded = 0;
+	first_indexed_line = 1;
+	lines_read = 0;
+	active = this;
+}
+
+
+source_buffer::source_buffer(string source_filename) : source_buffer::source_buffer()
+// Map the source file. Raise exception if it is not present.
+{
+	filename = source_filename;
+	if (source_filename == "-")
+	{
+		start_stream(STDIN_FILENO);
+		return;
+	}
+	if (!filesystem::exists(source_filename))
+	{
+		cerr << "Source code file not found." << endl;
+		throw lille_exception("Source code file not found.");
+	}
+
+	int fd = open(source_filename.c_str(), O_RDONLY);
+	struct stat st;
+	if ((fd >= 0) and (fstat(fd, &st) == 0) and !S_ISREG(st.st_mode))
+	{
+		start_stream(fd);		// a pipe, such as /dev/fd/3 or a named pipe; its length is not known in advance
+		return;
+	}
+	if ((fd < 0) or (fstat(fd, &st) != 0) or !map_file(fd, st.st_size))
+		read_file();
+	if (fd >= 0)
+		close(fd);
+	if (length >= no_offset)
+	{
+		cerr << "Source code file is too large." << endl;
+		throw lille_exception("Source code file is too large.");
+	}
+}
+
+
+source_buffer::source_buffer(source_buffer* original, uint32_t offset, uint32_t removed, const string& inserted)
+	: source_buffer::source_buffer()
+// Copy the text of original around the edit.
+{
+	if (original->is_streamed() or (offset > original->size()) or (removed > original->size() - offset))
+		throw lille_exception("Edit lies outside the source.");
+	filename = original->filename;
+	length = original->size() - removed + inserted.size();
+	if (length >= no_offset)
+		throw lille_exception("Source code file is too large.");
+
+	heap_copy = new char[length + 1];
+	memcpy(heap_copy, original->text, offset);
+	memcpy(heap_copy + offset, inserted.data(), inserted.size());
+	memcpy(heap_copy + offset + inserted.size(), original->text + offset + removed, original->size() - offset - removed);
+	heap_copy[length] = sentinel;
+	text = heap_copy;
+}
+
+
+source_buffer::~source_buffer()
+{
+	if (mapped_length > 0)
+		munmap((void*) text, mapped_length);
+	delete [] heap_copy;
+	if ((stream_fd >= 0) and (stream_fd != STDIN_FILENO))
+		close(stream_fd);
+	if (active == this)
+		active = NULL;
+}
+
+
+bool source_buffer::map_file(int fd, size_t file_size)
+// Reserve enough address space for the file plus the sentinel, then map the file over the start of it.
+// The kernel zero-fills the tail of the last file page, and if the file is an exact number of pages long
+// the sentinel lands on the anonymous page behind it, so text[length] always reads as '\0'.
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t reserved = ((file_size + 1 + page - 1) / page) * page;
+
+	void* region = mmap(NULL, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED)
+		return false;
+	if (file_size > 0)
+	{
+		if (mmap(region, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			munmap(region, reserved);
+			return false;
+		}
+		madvise(region, file_size, MADV_SEQUENTIAL);
+	}
+	text = (const char*) region;
+	length = file_size;
+	mapped_length = reserved;
+	return true;
+}
+
+
+void source_buffer::read_file()
+{
+	ifstream source_file(filename, ios::binary);
+	string contents((istreambuf_iterator<char>(source_file)), istreambuf_iterator<char>());
+
+	heap_copy = new char[contents.length() + 1];
+	memcpy(heap_copy, contents.data(), contents.length());
+	heap_copy[contents.length()] = sentinel;
+	text = heap_copy;
+	length = contents.length();
+	mapped_length = 0;
+}
+
+
+void source_buffer::start_stream(int fd)
+// The window starts empty; the first call to next_line() fills it.
+{
+	stream_fd = fd;
+	window_capacity = window_bytes;
+	heap_copy = new char[window_capacity];
+	heap_copy[0] = sentinel;
+	text = heap_copy;
+	length = 0;
+	stream_unread = text;
+}
+
+
+const char* source_buffer::refill(const char* keep)
+// The window only grows if a single line does not fit in it. Returns where the kept text now starts.
+{
+	size_t kept = end() - keep;
+	if (kept + 1 >= window_capacity / 2)
+	{
+		window_capacity *= 2;
+		char* larger = new char[window_capacity];
+		memcpy(larger, keep, kept);
+		delete [] heap_copy;
+		heap_copy = larger;
+	}
+	else
+		memmove(heap_copy, keep, kept);
+	stream_discarded += keep - text;
+	text = heap_copy;
+	length = kept;
+
+	while ((length + 1 < window_capacity) and !stream_ended)
+	{
+		ssize_t got = read(stream_fd, heap_copy + length, window_capacity - 1 - length);
+		if (got > 0)
+		{
+			length += got;
+			break;				// a pipe hands over what it has; use it rather than wait for more
+		}
+		else if ((got == 0) or (errno != EINTR))
+			stream_ended = true;
+	}
+	heap_copy[length] = sentinel;
+	if (stream_discarded + length >= no_offset)
+	{
+		cerr << "Source code file is too large." << endl;
+		throw lille_exception("Source code file is too large.");
+	}
+	return text;
+}
+
+
+const char* source_buffer::begin()
+{
+	return text;
+}
+
+
+const char* source_buffer::end()
+{
+	return text + length;
+}
+
+
+size_t source_buffer::size()
+{
+	return length;
+}
+
+
+bool source_buffer::is_mapped()
+{
+	return mapped_length > 0;
+}
+
+
+bool source_buffer::is_streamed()
+{
+	return stream_fd >= 0;
+}
+
+
+const char* source_buffer::next_line(const char*& p, const char*& line_end)
+{
+	line_end = (const char*) memchr(p, '\n', end() - p);
+	while ((line_end == NULL) and (stream_fd >= 0) and !stream_ended)
+	{
+		size_t searched = end() - p;
+		p = refill(p);
+		line_end = (const char*) memchr(p + searched, '\n', end() - (p + searched));
+	}
+	stream_unread = (line_end == NULL) ? end() : line_end + 1;
+	if (stream_fd >= 0)
+	{
+		if (line_starts.size() >= 2 * indexed_stream_lines)
+		{
+			line_starts.erase(line_starts.begin(), line_starts.end() - indexed_stream_lines);
+			first_indexed_line = lines_read + 1 - indexed_stream_lines;
+		}
+		line_starts.push_back(offset_of(p));
+		lines_read++;
+	}
+	if (line_end == NULL)
+	{
+		line_end = end();
+		return end();
+	}
+	return line_end + 1;
+}
+
+
+const char* source_buffer::unread_text()
+{
+	return stream_unread;
+}
+
+
+uint32_t source_buffer::offset_of(const char* p)
+{
+	return stream_discarded + (p - text);
+}
+
+
+void source_buffer::locate(uint32_t offset, int& line, int& pos)
+// A whole text is indexed the first time a position is wanted, splitting lines on '\n' alone as next_line()
+// does. A stream has been indexed line by line as it was read.
+{
+	if ((stream_fd < 0) and line_starts.empty())
+	{
+		line_starts.push_back(0);
+		for (const char* p = text; (p = (const char*) memchr(p, '\n', end() - p)) != NULL; p++)
+			line_starts.push_back((p + 1) - text);
+	}
+
+	if ((offset == no_offset) or line_starts.empty() or (offset < line_starts[0]))
+	{
+		line = 0;
+		pos = 0;
+	}
+	else if ((offset >= stream_discarded + length) and ((stream_fd < 0) or stream_ended))
+	{
+		line = first_indexed_line + line_starts.size() - 1;
+		pos = -1;
+	}
+	else
+	{
+		size_t i = upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin() - 1;
+		line = first_indexed_line + i;
+		pos = offset - line_starts[i];
+	}
+}
+
+
+string source_buffer::name()
+{
+	return filename;
+}
+
+
+source_buffer* source_buffer::current()
+{
+	if (active == NULL)
+		throw lille_exception("No source_buffer exists for token positions.");
+	return active;
+}
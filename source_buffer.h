@@ -0,0 +1,106 @@
+#ifndef SOURCE_BUFFER_H_
+#define SOURCE_BUFFER_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+class source_buffer {
+private:
+	string filename;				// Name of the source file held in the buffer.
+	const char* text;				// First byte of the source text. The byte at text[length] is always the sentinel.
+	size_t length;					// Number of bytes of source text, not counting the sentinel.
+	size_t mapped_length;			// Size of the mmap'd region, or 0 if the text is held in heap_copy.
+	char* heap_copy;				// Copy of the source text used when the file cannot be mapped.
+
+	int stream_fd;					// Pipe or terminal the source is read from a window at a time, or -1 if the
+									// whole text is held. When streaming, text is the window and length is the
+									// number of bytes in it.
+	size_t window_capacity;			// Size of the window, including the byte for the sentinel.
+	bool stream_ended;				// Nothing more can be read from stream_fd.
+	const char* stream_unread;		// Start of the line after the last one next_line() returned.
+	size_t stream_discarded;		// Bytes of a streamed source already shifted out of the window.
+
+	static const size_t window_bytes = 64 * 1024;	// Initial window; it only grows to hold a longer line.
+
+	vector<uint32_t> line_starts;	// Offset of the first character of each line, from line first_indexed_line on.
+									// Built on first use for a whole text; kept by next_line() for a stream.
+	size_t first_indexed_line;		// Line number of line_starts[0]. Only a stream drops lines from the index.
+	size_t lines_read;				// Lines handed out by next_line() from a stream.
+
+	static const size_t indexed_stream_lines = 64 * 1024;	// Lines of a stream kept in the index. Tokens
+															// further back than that are long gone.
+
+	static thread_local source_buffer* active;	// Source that tokens resolve their positions in, one per thread.
+
+	source_buffer();
+	bool map_file(int fd, size_t file_size);	// Map the open file fd. Returns false if mmap is not possible.
+	void read_file();							// Fallback: read the whole file into heap_copy.
+	void start_stream(int fd);					// Read fd through a window rather than holding all of it.
+	const char* refill(const char* keep);		// Move [keep, end()) to the front of the window and read more after it.
+
+public:
+	static const char sentinel = '\0';	// Always follows the last byte of the source text so the scanner can peek
+										// one character ahead without a bounds check.
+
+	static const uint32_t no_offset = UINT32_MAX;	// Offset of something with no place in the source.
+
+	source_buffer(string source_filename);
+	// Maps the whole of source_filename into memory. Raises a lille_exception if the file does not exist.
+	// A name of "-" means standard input. Standard input, pipes and other files that are not regular files
+	// are streamed: only the window around the line being scanned is held, however long the input is.
+	// Source text must be under 4 GB, so every offset fits in 32 bits. The new buffer becomes the one tokens
+	// resolve their positions in.
+
+	source_buffer(source_buffer* original, uint32_t offset, uint32_t removed, const string& inserted);
+	// Holds a copy of the text of original with an edit made to it: removed bytes from offset on are replaced
+	// by inserted. Raises a lille_exception if original is streamed or the edit lies outside it.
+
+	~source_buffer();
+
+	const char* begin();
+	// First byte of the source text. For a streamed source, first byte of the window.
+
+	const char* end();
+	// One past the last byte of the source text. *end() is the sentinel.
+	// For a streamed source, one past the last byte read so far.
+
+	size_t size();
+	// Number of bytes of source text; for a streamed source, the number in the window.
+
+	bool is_streamed();
+	// True if the source is read a window at a time, so the whole text is never in memory at once.
+
+	bool is_mapped();
+	// True if the text is mapped directly from the file rather than copied.
+
+	const char* next_line(const char*& p, const char*& line_end);
+	// Given p, the start of a line, sets line_end to the '\n' (or sentinel) that terminates it and returns
+	// the start of the following line.
+	// For a streamed source, more is read if the line is not all in the window yet. Everything before p is
+	// discarded to make room, and p is moved with the text it points at, so only the latest line returned
+	// stays valid.
+
+	const char* unread_text();
+	// For a streamed source, the start of the line after the last one next_line() returned, from which the
+	// rest of the source can still be read.
+
+	uint32_t offset_of(const char* p);
+	// Offset from the start of the source of the character at p, which must be in the window or text.
+
+	void locate(uint32_t offset, int& line, int& pos);
+	// Sets line and pos to the line number and position on that line of the character offset bytes into
+	// the source. The end of the source is at position -1 on the last line, where the scanner reports it.
+	// No_offset, and for a stream an offset from before the lines still indexed, are at line 0, position 0.
+
+	string name();
+	// Name of the source file.
+
+	static source_buffer* current();
+	// The source of the compilation in progress.
+};
+
+#endif /* SOURCE_BUFFER_H_ */
@@ -10,46 +10,193 @@
 #include <string>
 #include <cctype>
 #include <cmath>
+#include <type_traits>
 
 #include "symbol.h"
 
 using namespace std;
 
-
-symbol::symbol()
-{
-	sym = invalid_sym;
-	establish_symbol_map();
+namespace {
+
+	// Reserved words of lille, in upper case, with the symbol each one maps onto.
+	struct reserved_word {
+		const char* spelling;
+		symbol::symbol_type sym;
+	};
+
+	constexpr reserved_word reserved_words[] = {
+		{"AND", symbol::and_sym},
+		{"BEGIN", symbol::begin_sym},
+		{"BOOLEAN", symbol::boolean_sym},
+		{"CONSTANT", symbol::constant_sym},
+		{"ELSE", symbol::else_sym},
+		{"ELSIF", symbol::elsif_sym},
+		{"END", symbol::end_sym},
+		{"EOF", symbol::eof_sym},
+		{"EXIT", symbol::exit_sym},
+		{"FALSE", symbol::false_sym},
+		{"FOR", symbol::for_sym},
+		{"FUNCTION", symbol::function_sym},
+		{"IF", symbol::if_sym},
+		{"IN", symbol::in_sym},
+		{"INTEGER", symbol::integer_sym},
+		{"IS", symbol::is_sym},
+		{"LOOP", symbol::loop_sym},
+		{"NOT", symbol::not_sym},
+		{"NULL", symbol::null_sym},
+		{"ODD", symbol::odd_sym},
+		{"OR", symbol::or_sym},
+		{"PRAGMA", symbol::pragma_sym},
+		{"PROCEDURE", symbol::procedure_sym},
+		{"PROGRAM", symbol::program_sym},
+		{"READ", symbol::read_sym},
+		{"REAL", symbol::real_sym},
+		{"REF", symbol::ref_sym},
+		{"RETURN", symbol::return_sym},
+		{"REVERSE", symbol::reverse_sym},
+		{"STRING", symbol::string_sym},
+		{"THEN", symbol::then_sym},
+		{"TRUE", symbol::true_sym},
+		{"VALUE", symbol::value_sym},
+		{"WHEN", symbol::when_sym},
+		{"WRITE", symbol::write_sym},
+		{"WRITELN", symbol::writeln_sym},
+		{"WHILE", symbol::while_sym},
+	};
+
+	const int keyword_table_size = 128;		// Must be a power of 2.
+	const int min_keyword_length = 2;		// IF, IN, IS, OR
+	const int max_keyword_length = 9;		// PROCEDURE
+
+	constexpr int keyword_hash(const char* s, int length)
+	// Perfect hash over the reserved words, using the length and the first, second and last characters.
+	// Letters are folded to upper case with & 0xDF. Digits and '_' fold to values no letter produces,
+	// so they can never make an identifier compare equal to a reserved word.
+	{
+		return (length + (s[0] & 0xDF) + ((s[1] & 0xDF) << 3) + (s[length - 1] & 0xDF) * 29) & (keyword_table_size - 1);
+	}
+
+	struct keyword_table {
+		struct {
+			const char* spelling;	// NULL for an empty slot.
+			int length;				// 0 for an empty slot, so it never matches.
+			symbol::symbol_type sym;
+		} slot[keyword_table_size];
+		bool perfect;				// true if no two reserved words hash to the same slot.
+	};
+
+	constexpr keyword_table build_keyword_table()
+	{
+		keyword_table t {};
+		t.perfect = true;
+		for (const reserved_word& w : reserved_words)
+		{
+			int length = 0;
+			while (w.spelling[length] != '\0')
+				length++;
+			int h = keyword_hash(w.spelling, length);
+			if ((t.slot[h].spelling != NULL) or (length < min_keyword_length) or (length > max_keyword_length))
+				t.perfect = false;
+			t.slot[h] = {w.spelling, length, w.sym};
+		}
+		return t;
+	}
+
+	constexpr keyword_table keyword_map = build_keyword_table();
+	static_assert(keyword_map.perfect, "keyword_hash must give every reserved word a slot of its own");
 }
 
 
-symbol::symbol(symbol::symbol_type s) : symbol()
-{
-	sym = s;
-}
+static_assert(is_trivially_copyable<symbol>::value, "symbol must stay a plain value type");
+
+
+// Mapping of symbol_type to a string for printing purposes.
+const char* const symbol::symbol_string[arrsize] = {
+	"Nul",
+	"Identifier",
+	"Strng",
+	"Real_num",
+	"Integer",
+	"End_of_program",
+	"Semicolon_sym",
+	"Comma_sym",
+	"Colon_sym",
+	"Equals_sym",
+	"Not_equals_sym",
+	"less_than_sym",
+	"Greater_than_sym",
+	"Less_or_equal_sym",
+	"Greater_or_equal_sym",
+	"Plus_sym",
+	"Minus_sym",
+	"Slash_sym",
+	"Asterisk_sym",
+	"Power_sym",
+	"Ampersand_sym",
+	"Left_paren_sym",
+	"Right_paren_sym",
+	"Range_sym",
+	"Becomes_sym",
+	"And_sym",
+	"Begin_sym",
+	"Boolean_sym",
+	"Constant_sym",
+	"Else_sym",
+	"Elsif_sym",
+	"End_sym",
+	"Eof_sym",
+	"Exit_sym",
+	"False_sym",
+	"For_sym",
+	"Function_sym",
+	"If_sym",
+	"In_sym",
+	"Integer_sym",
+	"Is_sym",
+	"Loop_sym",
+	"Not_sym",
+	"Null_sym",
+	"Odd_sym",
+	"Or_sym",
+	"Pragma_sym",
+	"Procedure_sym",
+	"Program_sym",
+	"Read_sym",
+	"Real_sym",
+	"Ref_sym",
+	"Return_sym",
+	"Reverse_sym",
+	"String_sym",
+	"Then_sym",
+	"True_sym",
+	"Value_sym",
+	"When_sym",
+	"Write_sym",
+	"Writeln_sym",
+	"While_sym",
+	"Invalid_sym",
+};
 
 
-symbol::symbol(const symbol& s2)
+symbol::symbol()
 {
-	symbol::sym = s2.sym;
-
+	sym = invalid_sym;
 }
 
 
-bool symbol::operator==(const symbol& s2)
+symbol::symbol(symbol::symbol_type s)
 {
-	return (sym == s2.sym);
+	sym = s;
 }
 
 
-symbol symbol::operator=(const symbol& sym2)
+bool symbol::operator==(const symbol& s2) const
 {
-	symbol::sym = sym2.sym;
-	return *this;
+	return (sym == s2.sym);
 }
 
 
-symbol::symbol_type symbol::get_sym()
+symbol::symbol_type symbol::get_sym() const
 {
 	return sym;
 }
@@ -61,78 +208,24 @@ void symbol::set_sym(symbol_type s)
 }
 
 
-string symbol::symtostr()
+string symbol::symtostr() const
 {
 	return symbol_string[sym];
 }
 
 
-void symbol::establish_symbol_map()
+symbol::symbol_type symbol::keyword(const char* s, int length)
+// Look up a candidate reserved word in the compile-time perfect hash table. At most one slot is
+// examined, and it is compared byte by byte with case folding.
 {
-
-	// Set up the mapping of symbol_type to a string for printing purposes.
-
-	symbol::symbol_string[nul] = "Nul";
-	symbol::symbol_string[identifier] = "Identifier";
-	symbol::symbol_string[strng] = "Strng";
-	symbol::symbol_string[real_num] = "Real_num";
-	symbol::symbol_string[integer] = "Integer";
-	symbol::symbol_string[end_of_program] = "End_of_program";
-	symbol::symbol_string[semicolon_sym] = "Semicolon_sym";
-	symbol::symbol_string[comma_sym] = "Comma_sym";
-	symbol::symbol_string[colon_sym] = "Colon_sym";
-	symbol::symbol_string[equals_sym] = "Equals_sym";
-	symbol::symbol_string[not_equals_sym] = "Not_equals_sym";
-	symbol::symbol_string[less_than_sym] = "less_than_sym";
-	symbol::symbol_string[greater_than_sym] = "Greater_than_sym";
-	symbol::symbol_string[less_or_equal_sym] = "Less_or_equal_sym";
-	symbol::symbol_string[greater_or_equal_sym] = "Greater_or_equal_sym";
-	symbol::symbol_string[plus_sym] = "Plus_sym";
-	symbol::symbol_string[minus_sym] = "Minus_sym";
-	symbol::symbol_string[slash_sym] = "Slash_sym";
-	symbol::symbol_string[asterisk_sym] = "Asterisk_sym";
-	symbol::symbol_string[power_sym] = "Power_sym";
-	symbol::symbol_string[ampersand_sym] = "Ampersand_sym";
-	symbol::symbol_string[left_paren_sym] = "Left_paren_sym";
-	symbol::symbol_string[right_paren_sym] = "Right_paren_sym";
-	symbol::symbol_string[range_sym] = "Range_sym";
-	symbol::symbol_string[becomes_sym] = "Becomes_sym";
-	symbol::symbol_string[and_sym] = "And_sym";
-	symbol::symbol_string[begin_sym] = "Begin_sym";
-	symbol::symbol_string[boolean_sym] = "Boolean_sym";
-	symbol::symbol_string[constant_sym] = "Constant_sym";
-	symbol::symbol_string[else_sym] = "Else_sym";
-	symbol::symbol_string[elsif_sym] = "Elsif_sym";
-	symbol::symbol_string[end_sym] = "End_sym";
-	symbol::symbol_string[eof_sym] = "Eof_sym";
-	symbol::symbol_string[exit_sym] = "Exit_sym";
-	symbol::symbol_string[false_sym] = "False_sym";
-	symbol::symbol_string[for_sym] = "For_sym";
-	symbol::symbol_string[function_sym] = "Function_sym";
-	symbol::symbol_string[if_sym] = "If_sym";
-	symbol::symbol_string[in_sym] = "In_sym";
-	symbol::symbol_string[integer_sym] = "Integer_sym";
-	symbol::symbol_string[is_sym] = "Is_sym";
-	symbol::symbol_string[loop_sym] = "Loop_sym";
-	symbol::symbol_string[not_sym] = "Not_sym";
-	symbol::symbol_string[null_sym] = "Null_sym";
-	symbol::symbol_string[odd_sym] = "Odd_sym";
-	symbol::symbol_string[or_sym] = "Or_sym";
-	symbol::symbol_string[pragma_sym] = "Pragma_sym";
-	symbol::symbol_string[procedure_sym] = "Procedure_sym";
-	symbol::symbol_string[program_sym] = "Program_sym";
-	symbol::symbol_string[read_sym] = "Read_sym";
-	symbol::symbol_string[real_sym] = "Real_sym";
-	symbol::symbol_string[ref_sym] = "Ref_sym";
-	symbol::symbol_string[return_sym] = "Return_sym";
-	symbol::symbol_string[reverse_sym] = "Reverse_sym";
-	symbol::symbol_string[string_sym] = "String_sym";
-	symbol::symbol_string[then_sym] = "Then_sym";
-	symbol::symbol_string[true_sym] = "True_sym";
-	symbol::symbol_string[value_sym] = "Value_sym";
-	symbol::symbol_string[when_sym] = "When_sym";
-	symbol::symbol_string[write_sym] = "Write_sym";
-	symbol::symbol_string[writeln_sym] = "Writeln_sym";
-	symbol::symbol_string[while_sym] = "While_sym";
-	symbol::symbol_string[invalid_sym] = "Invalid_sym";
+	if ((length < min_keyword_length) or (length > max_keyword_length))
+		return identifier;
+
+	const auto& k = keyword_map.slot[keyword_hash(s, length)];
+	if (k.length != length)
+		return identifier;
+	for (int i = 0; i < length; i++)
+		if ((s[i] & 0xDF) != k.spelling[i])
+			return identifier;
+	return k.sym;
 }
@@ -10,6 +10,8 @@
 
 #include <iostream>
 #include <string>
+#include <cstdint>
+#include <initializer_list>
 
 using namespace std;
 
@@ -83,30 +85,56 @@ public:
 	};
 
 
+	// A symbol is a plain value holding just its symbol_type, so it can be created, copied and compared
+	// without allocating. Names for printing come from one static table shared by every symbol.
 	symbol();
 	symbol(symbol_type s);
-	symbol(const symbol& s2);
+	symbol(const symbol& s2) = default;
+	symbol& operator=(const symbol& sym2) = default;
 
-    bool operator==(const symbol& s2);
-    symbol operator=(const symbol& sym2);
+    bool operator==(const symbol& s2) const;
 
-	symbol::symbol_type get_sym();
+	symbol::symbol_type get_sym() const;
 	void set_sym(symbol_type s);
 
-	string symtostr();
+	string symtostr() const;
+
+	static symbol_type keyword(const char* s, int length);
+	// Returns the reserved word spelled (in any case) by the length characters at s, or identifier if
+	// they do not spell a reserved word. Works on the raw source bytes; no string is built.
 
 private:
 
 	symbol_type sym;
 
 	enum {arrsize = int(symbol_type::invalid_sym) + 1};
-		//string symbol_string[arrsize]; // used to help output the symbols in the enumerated type above. Helpful for debugging.
+	static const char* const symbol_string[arrsize]; // used to help output the symbols in the enumerated type above. Helpful for debugging.
 
-	string symbol_string[arrsize];
+}; /* class symbol */
 
-	void establish_symbol_map();
 
-}; /* class symbol */
+class symbol_set {
+// A set of symbol_types, one bit per symbol, so asking whether the current symbol is any of a dozen is a
+// single mask test. Sets are literal values and can be built at compile time.
+public:
+	constexpr symbol_set() : bits(0) { }
+	constexpr symbol_set(initializer_list<symbol::symbol_type> symbols) : bits(0)
+	{
+		for (symbol::symbol_type s : symbols)
+			bits |= bit(s);
+	}
+
+	constexpr bool contains(symbol::symbol_type s) const { return (bits & bit(s)) != 0; }
+	constexpr symbol_set operator|(const symbol_set& other) const { return symbol_set(bits | other.bits); }
+	constexpr bool operator==(const symbol_set& other) const { return bits == other.bits; }
+
+private:
+	uint64_t bits;
+
+	constexpr explicit symbol_set(uint64_t b) : bits(b) { }
+	static constexpr uint64_t bit(symbol::symbol_type s) { return uint64_t(1) << s; }
+	static_assert(symbol::invalid_sym < 64, "every symbol_type needs a bit of its own");
+};
 
 #endif /* SYMBOL_H_ */
 
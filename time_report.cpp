@@ -0,0 +1,121 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+
+#include "time_report.h"
+
+using namespace std;
+using namespace std::chrono;
+
+thread_local time_report* time_report::active = NULL;
+
+
+time_report::time_report()
+{
+	for (int i = 0; i < phase_count; i++)
+		phase_nanos[i] = 0;
+	for (int i = 0; i < counter_count; i++)
+		counters[i] = 0;
+	current_phase = setup_phase;
+	started = steady_clock::now();
+	last_switch = started;
+	active = this;
+}
+
+
+time_report::~time_report()
+{
+	if (active == this)
+		active = NULL;
+}
+
+
+void time_report::switch_to(phase p)
+{
+	steady_clock::time_point now = steady_clock::now();
+	phase_nanos[current_phase] += duration_cast<nanoseconds>(now - last_switch).count();
+	last_switch = now;
+	current_phase = p;
+}
+
+
+const char* time_report::phase_name(phase p)
+{
+	switch (p)
+	{
+	case setup_phase:			return "setup";
+	case scanner_phase:			return "scanner";
+	case parser_phase:			return "parser";
+	case symbol_table_phase:	return "symbol table";
+	case error_phase:			return "errors and listing";
+	case output_phase:			return "output";
+	default:					return "";
+	}
+}
+
+
+const char* time_report::counter_name(counter c)
+{
+	switch (c)
+	{
+	case tokens_counter:		return "tokens";
+	case names_counter:			return "identifiers interned";
+	case lookups_counter:		return "table lookups";
+	case probes_counter:		return "name table probes";
+	case scopes_counter:		return "scopes entered";
+	case errors_counter:		return "errors flagged";
+	default:					return "";
+	}
+}
+
+
+time_report* time_report::current()
+{
+	return active;
+}
+
+
+void time_report::print_table(ostream& out, string source_name)
+{
+	switch_to(current_phase);		// bring the running phase up to date
+	double total_ms = duration_cast<nanoseconds>(last_switch - started).count() / 1e6;
+
+	out << "Time report for " << source_name << endl;
+	out << "  " << left << setw(22) << "phase" << right << setw(12) << "ms" << setw(9) << "%" << endl;
+	for (int i = 0; i < phase_count; i++)
+	{
+		double ms = phase_nanos[i] / 1e6;
+		out << "  " << left << setw(22) << phase_name(phase(i)) << right << fixed << setprecision(3) << setw(12) << ms
+			<< setprecision(1) << setw(8) << (total_ms > 0 ? 100 * ms / total_ms : 0) << "%" << endl;
+	}
+	out << "  " << left << setw(22) << "total" << right << setprecision(3) << setw(12) << total_ms << endl;
+	out << endl;
+	for (int i = 0; i < counter_count; i++)
+		out << "  " << left << setw(22) << counter_name(counter(i)) << right << setw(12) << counters[i] << endl;
+	out << defaultfloat << setprecision(6);
+}
+
+
+void time_report::print_json(ostream& out, string source_name)
+{
+	switch_to(current_phase);
+	uint64_t total_nanos = duration_cast<nanoseconds>(last_switch - started).count();
+
+	// Source names are file paths; only quotes and backslashes need escaping.
+	string escaped;
+	for (char c : source_name)
+	{
+		if ((c == '"') or (c == '\\'))
+			escaped += '\\';
+		escaped += c;
+	}
+
+	out << "{\"source\":\"" << escaped << "\",\"total_ns\":" << total_nanos << ",\"phases_ns\":{";
+	for (int i = 0; i < phase_count; i++)
+		out << (i > 0 ? "," : "") << "\"" << phase_name(phase(i)) << "\":" << phase_nanos[i];
+	out << "},\"counters\":{";
+	for (int i = 0; i < counter_count; i++)
+		out << (i > 0 ? "," : "") << "\"" << counter_name(counter(i)) << "\":" << counters[i];
+	out << "}}" << endl;
+}
@@ -0,0 +1,92 @@
+#ifndef TIME_REPORT_H_
+#define TIME_REPORT_H_
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+class time_report {
+public:
+	enum phase {
+		setup_phase,			// command line, mapping the source, building the compiler objects
+		scanner_phase,			// scanner::get_token, including identifier interning
+		parser_phase,			// parser, excluding the time it spends in the other phases
+		symbol_table_phase,		// id_table entries, scopes and lookups
+		error_phase,			// flagging errors and writing the listing
+		output_phase,			// code generation and the final summary
+		phase_count
+	};
+
+	enum counter {
+		tokens_counter,			// tokens returned by the scanner
+		names_counter,			// distinct identifiers interned
+		lookups_counter,		// id_table lookups
+		probes_counter,			// name_table hash slots inspected
+		scopes_counter,			// scopes entered
+		errors_counter,			// errors flagged
+		counter_count
+	};
+
+	class phase_guard {
+	// Charges the time until the guard goes out of scope to phase p, then resumes the phase that was
+	// running before. Time is exclusive: a scanner call made by the parser counts as scanner time only.
+	// Does nothing unless a report is being collected.
+	private:
+		phase previous;
+	public:
+		phase_guard(phase p)
+		{
+			if (active != NULL)
+			{
+				previous = active->current_phase;
+				active->switch_to(p);
+			}
+		}
+		~phase_guard()
+		{
+			if (active != NULL)
+				active->switch_to(previous);
+		}
+	};
+
+private:
+	static thread_local time_report* active;		// Report being collected, or NULL if none was asked for. Only the
+													// thread that created the report records into it.
+
+	chrono::steady_clock::time_point started;
+	chrono::steady_clock::time_point last_switch;	// When current_phase was entered.
+	phase current_phase;
+	uint64_t phase_nanos[phase_count];
+	uint64_t counters[counter_count];
+
+	void switch_to(phase p);						// Charge the time since last_switch to current_phase and enter p.
+	static const char* phase_name(phase p);
+	static const char* counter_name(counter c);
+
+public:
+	time_report();
+	// Starts collecting, in the setup phase. Guards and counters record into this report from now on.
+
+	~time_report();
+
+	static void count(counter c, uint64_t n = 1)
+	// Add n to counter c, if a report is being collected.
+	{
+		if (active != NULL)
+			active->counters[c] += n;
+	}
+
+	static time_report* current();
+	// The report being collected, or NULL.
+
+	void print_table(ostream& out, string source_name);
+	// Write the phases and counters as a table, in the style of -ftime-report.
+
+	void print_json(ostream& out, string source_name);
+	// Write the phases and counters as a single line JSON object, for tracking across builds.
+};
+
+#endif /* TIME_REPORT_H_ */
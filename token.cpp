@@ -7,100 +7,83 @@
 
 #include <iostream>
 #include <string>
+#include <cstring>
 
 #include "symbol.h"
 #include "token.h"
 #include "lille_exception.h"
+#include "token_pool.h"
+#include "name_table.h"
 
 using namespace std;
 
 
+static_assert(sizeof(token) <= 12, "token must stay compact; values that do not fit belong in the token_pool");
+static_assert(sizeof(uint32_t) == 4 and sizeof(float) == 4 and sizeof(int) == 4, "every payload must fit in 32 bits");
+
+
 token::token()
 // Constructor
 {
-	token::sym = new symbol(symbol::nul);
-	token::line_number = 0;
-	token::pos_on_line = 0;
-	token::real_value = 0.0;
-	token::integer_value = 0;
-	token::string_value = "";
-	token::identifier_value = "";
+	token::sym = symbol(symbol::nul);
+	token::offset = source_buffer::no_offset;
+	token::payload.integer_value = 0;
 }
 
 
-token::token(symbol *s, int line, int pos)
+token::token(symbol s, uint32_t at)
 // Constructor
 {
 	token::sym = s;
-	token::line_number = line;
-	token::pos_on_line = pos;
-	token::real_value = 0.0;
-	token::integer_value = 0;
-	token::string_value = "";
-	token::identifier_value = "";
-}
-
-
-token::token(const token& t)
-// copy constructor
-{
-	token::sym = t.sym;
-	token::line_number = t.line_number;
-	token::pos_on_line = t.pos_on_line;
-	token::real_value = t.real_value;
-	token::integer_value = t.integer_value;
-	token::string_value = t.string_value;
-	token::identifier_value = t.identifier_value;
+	token::offset = at;
+	token::payload.integer_value = 0;
 }
 
 
-token& token::operator=(const token& t)
-// copy assignment
+symbol::symbol_type token::get_sym()
+// returns the symbol.
 {
-	token::sym = t.sym;
-	token::line_number = t.line_number;
-	token::pos_on_line = t.pos_on_line;
-	token::real_value = t.real_value;
-	token::integer_value = t.integer_value;
-	token::string_value = t.string_value;
-	token::identifier_value = t.identifier_value;
-	return *this;
+	return sym.get_sym();
 }
 
 
-symbol::symbol_type token::get_sym()
+symbol token::get_symbol()
 // returns the symbol.
 {
-	return sym->get_sym();
+	return sym;
 }
 
 
-symbol * token::get_symbol()
-// returns the symbol.
+uint32_t token::get_offset()
+// returns the byte offset in the source.
 {
-	return sym;
+	return offset;
 }
 
 
 int token::get_line_number()
 // returns the line number
 {
-	return line_number;
+	int line, pos;
+	source_buffer::current()->locate(offset, line, pos);
+	return line;
 }
 
 
 int token::get_pos_on_line()
 // returns the position on the line.
 {
-	return pos_on_line;
+	int line, pos;
+	source_buffer::current()->locate(offset, line, pos);
+	return pos;
 }
 
 
 float token::get_real_value()
 // returns the real only if the symbol is a real_number. Raises a lille_exceeption otherwise.
 {
-	if (sym->get_sym() == symbol::real_num)
-		return real_value;
+	if (sym.get_sym() == symbol::real_num)
+		return payload.real_value;
 	else
 		throw lille_exception("Illegal access to real_value in token.");
 }
@@ -109,8 +92,8 @@ float token::get_real_value()
 int token::get_integer_value()
 // returns the integer_value only if the symbol is a integer_number. Raises a lille_exceeption otherwise.
 {
-	if (sym->get_sym() == symbol::integer)
-		return integer_value;
+	if (sym.get_sym() == symbol::integer)
+		return payload.integer_value;
 	else
 		throw lille_exception("Illegal access to integer_value in token.");
 }
@@ -119,8 +102,8 @@ int token::get_integer_value()
 string token::get_string_value()
 // returns the string_value only if the symbol is a string. Raises a lille_exceeption otherwise.
 {
-	if (sym->get_sym() == symbol::strng)
-		return string_value;
+	if (sym.get_sym() == symbol::strng)
+		return token_pool::current()->string_at(payload.string_index);
 	else
 		throw lille_exception("Illegal access to string_value in token.");
 }
@@ -129,36 +112,36 @@ string token::get_string_value()
 string token::get_identifier_value()
 // returns the string_value only if the symbol is an identifier. Raises a lille_exceeption otherwise.
 {
-	if (sym->get_sym() == symbol::identifier)
-		return identifier_value;
+	if (sym.get_sym() == symbol::identifier)
+		return name_table::current()->name(payload.name_id);
 	else
 		return "";
 		//throw lille_exception("Illegal access to identifier_value in token.");
 }
 
 string token::get_prog_value() {
-	if(sym->get_sym() == symbol::program_sym)
-		return prog_value;
+	if(sym.get_sym() == symbol::program_sym)
+		return name_table::current()->name(payload.name_id);
 	else return "";
 }
 
 string token::get_proc_value() {
-	if(sym->get_sym() == symbol::procedure_sym)
-		return proc_value;
+	if(sym.get_sym() == symbol::procedure_sym)
+		return name_table::current()->name(payload.name_id);
 	else return "";
 }
 
 string token::get_fun_value() {
-	if(sym->get_sym() == symbol::function_sym)
-		return fun_value;
+	if(sym.get_sym() == symbol::function_sym)
+		return name_table::current()->name(payload.name_id);
 	else return "";
 }
 
 void token::set_real_value(float f)
 // Set the real_value to f only if the token represents a real_value. Raise an exception otherwise.
 {
-	if (sym->get_sym() == symbol::real_num)
-		real_value = f;
+	if (sym.get_sym() == symbol::real_num)
+		payload.real_value = f;
 	else
 		throw lille_exception("Illegal attempt to set real_value in token");
 }
@@ -167,8 +150,8 @@ void token::set_real_value(float f)
 void token::set_integer_value(int i)
 // Set the ingteger_value to i only if the token represents a integer_value. Raise an exception otherwise.
 {
-	if (sym->get_sym() == symbol::integer)
-		integer_value = i;
+	if (sym.get_sym() == symbol::integer)
+		payload.integer_value = i;
 	else
 		throw lille_exception("Illegal attempt to set integer_value in token");
 }
@@ -177,8 +160,8 @@ void token::set_integer_value(int i)
 void token::set_string_value(string s)
 // Set the string_value to s only if the token represents a string_value. Raise an exception otherwise.
 {
-	if (sym->get_sym() == symbol::strng)
-		string_value = s;
+	if (sym.get_sym() == symbol::strng)
+		payload.string_index = token_pool::current()->add_string(s);
 	else
 		throw lille_exception("Illegal attempt to set string_value in token");
 }
@@ -187,50 +170,92 @@ void token::set_string_value(string s)
 void token::set_identifier_value(string s)
 // Set the identifier_value to s only if the token represents an identifier. Raise an exception otherwise.
 {
-	if (sym->get_sym() == symbol::identifier)
-		identifier_value = s;
+	if (sym.get_sym() == symbol::identifier)
+		payload.name_id = name_table::current()->intern(s);
 	else
 		throw lille_exception("Illegal attempt to set identifier_value in token");
 }
 
 void token::set_prog_value(string s) {
-	if(sym->get_sym() == symbol::program_sym)
-		prog_value = s;
+	if(sym.get_sym() == symbol::program_sym)
+		payload.name_id = name_table::current()->intern(s);
 	else throw lille_exception("Illegal attempt to set prog_value in token");
 }
 
 void token::set_proc_value(string s) {
-	if(sym->get_sym() == symbol::procedure_sym)
-		proc_value = s;
+	if(sym.get_sym() == symbol::procedure_sym)
+		payload.name_id = name_table::current()->intern(s);
 	else throw lille_exception("Illegal attempt to set proc_value in token");
 }
 
 void token::set_fun_value(string s) {
-	if(sym->get_sym() == symbol::function_sym)
-		fun_value = s;
+	if(sym.get_sym() == symbol::function_sym)
+		payload.name_id = name_table::current()->intern(s);
 	else throw lille_exception("Illegal attempt to set fun_value in token");
 }
 
+static bool names_something(symbol::symbol_type s)
+// True if a token for symbol s carries a name_table ID.
+{
+	return (s == symbol::identifier) or (s == symbol::program_sym)
+			or (s == symbol::procedure_sym) or (s == symbol::function_sym);
+}
+
+
+int token::get_name_id()
+// returns the name_table ID of an identifier, program, procedure or function name. Raises a lille_exception otherwise.
+{
+	if (names_something(sym.get_sym()))
+		return payload.name_id;
+	else
+		throw lille_exception("Illegal access to name_id in token.");
+}
+
+
+void token::set_name_id(int id)
+// Set the name of an identifier, program, procedure or function to name_table ID id. Raise an exception otherwise.
+{
+	if (names_something(sym.get_sym()))
+		payload.name_id = id;
+	else
+		throw lille_exception("Illegal attempt to set name_id in token");
+}
+
+uint32_t token::get_payload()
+// returns the raw bits of whichever value the symbol carries.
+{
+	uint32_t bits;
+	memcpy(&bits, &payload, sizeof(bits));
+	return bits;
+}
+
+
+void token::set_payload(uint32_t bits)
+// Set the raw bits of the value, as returned by get_payload().
+{
+	memcpy(&payload, &bits, sizeof(bits));
+}
+
 void token::print_token()
 {
-	cout << "TOKEN: " << sym->symtostr();
-	if (sym->get_sym() == symbol::real_num)
-		cout << "  Value: " << real_value;
-	else if (sym->get_sym() == symbol::integer)
-		cout << "  Value: " << integer_value;
-	else if (sym->get_sym() == symbol::strng)
-		cout << "  Value: " << string_value;
-	else if (sym->get_sym() == symbol::identifier)
-		cout << "  Value: " << identifier_value;
-	cout << "  Line No: " << line_number << " Pos on line: " << pos_on_line << endl;
+	cout << "TOKEN: " << sym.symtostr();
+	if (sym.get_sym() == symbol::real_num)
+		cout << "  Value: " << get_real_value();
+	else if (sym.get_sym() == symbol::integer)
+		cout << "  Value: " << get_integer_value();
+	else if (sym.get_sym() == symbol::strng)
+		cout << "  Value: " << get_string_value();
+	else if (sym.get_sym() == symbol::identifier)
+		cout << "  Value: " << get_identifier_value();
+	cout << "  Line No: " << get_line_number() << " Pos on line: " << get_pos_on_line() << endl;
 }
 
 
 string token::to_string()
 {
 	string s = "";
-	s += "Name: " + this->identifier_value;
-	s += " Line No: " + ::to_string(line_number);
-	s += " Position: " + ::to_string(pos_on_line);
+	s += "Name: " + this->get_identifier_value();
+	s += " Line No: " + ::to_string(get_line_number());
+	s += " Position: " + ::to_string(get_pos_on_line());
 	return s;
 }
@@ -9,37 +9,40 @@
 #define TOKEN_H_
 
 #include <string>
+#include <cstdint>
 
 #include "symbol.h"
 #include "lille_exception.h"
+#include "source_buffer.h"
 
 using namespace std;
 
 
 class token {
 private:
-	symbol* sym;				// Symbol identified.
-	int line_number;			// Line number in source file where symbol is located.
-	int pos_on_line;			// Position on line in source file where the symbol is located.
-	float real_value;			// If symbol represents a real number, this is its value.
-	int integer_value;			// If symbol represents an integer value, this is its value.
-	string string_value;		// If symbol represents a string value, this is its value.
-	string identifier_value;	// If the symbol represents an identifier, this is its name.
-	string prog_value;
-	string proc_value;
-	string fun_value;
+	symbol sym;					// Symbol identified.
+	uint32_t offset;			// Byte offset in the source file of the first character of the symbol, or
+								// source_buffer::no_offset. Its line and position are only worked out if asked for.
+	union {
+		float real_value;		// If symbol represents a real number, this is its value.
+		int integer_value;		// If symbol represents an integer value, this is its value.
+		uint32_t string_index;	// If symbol represents a string value, this is the index of the text in the token_pool.
+		int name_id;			// If symbol represents an identifier, or the name of a program, procedure or function,
+								// this is its ID in the name_table.
+	} payload;					// Only one value is meaningful for any given symbol, so they share storage.
 
 public:
 	token();
-	token(symbol* s, int line, int pos);	// create a token - constructor.
+	token(symbol s, uint32_t at = source_buffer::no_offset);	// create a token at offset at - constructor.
 
-	token(const token& t);		// copy constructor
-	token& operator=(const token& t);	// copy assignment
+	token(const token& t) = default;		// copy constructor
+	token& operator=(const token& t) = default;	// copy assignment
 
 	symbol::symbol_type get_sym();			// returns the symbol.
-	symbol* get_symbol();
-	int get_line_number();		// returns the line number
-	int get_pos_on_line();		// returns the position on the line;
+	symbol get_symbol();
+	uint32_t get_offset();		// returns the byte offset in the source, or source_buffer::no_offset
+	int get_line_number();		// returns the line number, looked up in the current source_buffer
+	int get_pos_on_line();		// returns the position on the line, looked up in the current source_buffer
 	float get_real_value();		// returns the real only if the symbol is a real_number. Raises a DO_exceeption otherwise.
 	int get_integer_value();	// returns the integer_value only if the symbol is a integer_number. Raises a DO_exceeption otherwise.
 	string get_string_value();	// returns the string_value only if the symbol is a string. Raises a DO_exceeption otherwise.
@@ -47,6 +50,7 @@ public:
 	string get_prog_value();
 	string get_proc_value();
 	string get_fun_value();
+	int get_name_id();			// returns the name_table ID of an identifier, program, procedure or function name. Raises a lille_exception otherwise.
 
 	void set_real_value(float f); 	// Set the real_value to f only if the token represents a real_value. Raise an exception otherwise.
 	void set_integer_value(int i);	// Set the ingteger_value to i only if the token represents a integer_value. Raise an exception otherwise.
@@ -55,6 +59,10 @@ public:
 	void set_prog_value(string s);
 	void set_proc_value(string s);
 	void set_fun_value(string s);
+	void set_name_id(int id);	// Set the name of an identifier, program, procedure or function to name_table ID id. Raise an exception otherwise.
+
+	uint32_t get_payload();		// returns the raw bits of whichever value the symbol carries, for storing tokens compactly.
+	void set_payload(uint32_t bits);	// Set the raw bits of the value, as returned by get_payload().
 
 	void print_token();			// print out the token. Helpful for debugging.
 
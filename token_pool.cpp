@@ -0,0 +1,95 @@
+#include <string>
+#include <vector>
+
+#include "symbol.h"
+#include "token.h"
+#include "token_pool.h"
+#include "lille_exception.h"
+
+using namespace std;
+
+thread_local token_pool* token_pool::active = NULL;
+
+
+token_pool::token_pool()
+{
+	used_in_block = block_size;		// forces a block to be allocated on first use
+	allocated = 0;
+	recycling = false;
+	string_starts.push_back(0);		// start of the first string
+	add_string("");					// index 0 is the empty string, the value of a token whose text was never set
+	active = this;
+}
+
+
+token_pool::~token_pool()
+{
+	for (token* block : blocks)
+		delete [] block;
+	if (active == this)
+		active = NULL;
+}
+
+
+token* token_pool::allocate(symbol s, uint32_t offset)
+{
+	if (used_in_block == block_size)
+	{
+		if (recycling and !blocks.empty())
+		{
+			// Start the block again. The strings of the tokens being overwritten go too, keeping just the
+			// empty string at index 0.
+			string_chars.clear();
+			string_starts.resize(2);
+		}
+		else
+			blocks.push_back(new token[block_size]);
+		used_in_block = 0;
+	}
+	token* t = &blocks.back()[used_in_block++];
+	*t = token(s, offset);
+	allocated++;
+	return t;
+}
+
+
+uint32_t token_pool::add_string(const string& s)
+{
+	string_chars.insert(string_chars.end(), s.begin(), s.end());
+	string_starts.push_back(string_chars.size());
+	return string_starts.size() - 2;
+}
+
+
+string token_pool::string_at(uint32_t i)
+{
+	if (i + 1 >= string_starts.size())
+		throw lille_exception("Illegal string index in token_pool.");
+	return string(string_chars.data() + string_starts[i], string_chars.data() + string_starts[i + 1]);
+}
+
+
+void token_pool::recycle()
+{
+	recycling = true;
+}
+
+
+size_t token_pool::token_count()
+{
+	return allocated;
+}
+
+
+void token_pool::make_current()
+{
+	active = this;
+}
+
+
+token_pool* token_pool::current()
+{
+	if (active == NULL)
+		throw lille_exception("No token_pool exists for token string values.");
+	return active;
+}
@@ -0,0 +1,61 @@
+#ifndef TOKEN_POOL_H_
+#define TOKEN_POOL_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "symbol.h"
+#include "token.h"
+
+using namespace std;
+
+class token_pool {
+private:
+	static const int block_size = 4096;		// Number of tokens allocated at a time.
+
+	vector<token*> blocks;					// Blocks of block_size tokens. Tokens never move once handed out.
+	int used_in_block;						// Number of tokens handed out from the last block.
+	size_t allocated;						// Total number of tokens handed out.
+	bool recycling;							// Reuse the first block rather than adding more.
+
+	vector<char> string_chars;				// Text of every string payload, stored back to back.
+	vector<uint32_t> string_starts;			// string_starts[i] is where payload string i begins in string_chars.
+											// It ends where string i + 1 begins.
+
+	static thread_local token_pool* active;	// Pool used to resolve the string payloads of tokens, one per thread.
+
+public:
+	token_pool();
+	// Creates an empty pool for one compilation and makes it the pool that tokens use for their
+	// string payloads.
+
+	~token_pool();
+	// Releases every token and string payload in one go.
+
+	token* allocate(symbol s, uint32_t offset);
+	// Returns a token for symbol s offset bytes into the source. Memory is taken from the current block;
+	// a new block is only allocated every block_size tokens.
+
+	uint32_t add_string(const string& s);
+	// Appends s to the string side table and returns its index.
+
+	string string_at(uint32_t i);
+	// Returns the string with index i.
+
+	void recycle();
+	// From now on, once the first block is used up it is handed out again from the start, and the string
+	// payloads of the tokens it held are forgotten, so the pool never grows past one block. Only for when
+	// no token is used once block_size more have been handed out, as when scanning a streamed source.
+
+	size_t token_count();
+	// Number of tokens handed out so far.
+
+	void make_current();
+	// Make this the pool that tokens on this thread use for their string payloads again, after another was made.
+
+	static token_pool* current();
+	// The pool of the compilation in progress.
+};
+
+#endif /* TOKEN_POOL_H_ */
@@ -0,0 +1,202 @@
+#include <vector>
+#include <algorithm>
+
+#include "symbol.h"
+#include "token.h"
+#include "token_stream.h"
+#include "error_handler.h"
+#include "source_buffer.h"
+#include "token_pool.h"
+
+using namespace std;
+
+
+token_stream::token_stream(source_buffer* src)
+{
+	size_t expected = src->size() / 6;		// a rough guess at the tokens in typical Lille, to avoid most regrowth
+	kinds.reserve(expected);
+	offsets.reserve(expected);
+	payloads.reserve(expected);
+}
+
+
+token_stream::token_stream()
+{
+}
+
+
+void token_stream::add(symbol::symbol_type s, bool spelled, size_t offset, uint32_t payload)
+{
+	kinds.push_back(uint8_t(s) | (spelled ? spelled_flag : 0));
+	offsets.push_back(offset);
+	payloads.push_back(payload);
+}
+
+
+void token_stream::mark_after_pragma()
+{
+	kinds.back() |= pragma_flag;
+}
+
+
+void token_stream::hold_error(const error_handler::held_error& e)
+{
+	errors.push_back(e);
+	error_tokens.push_back(kinds.size());
+}
+
+
+size_t token_stream::size()
+{
+	return kinds.size();
+}
+
+
+symbol::symbol_type token_stream::kind(size_t i)
+{
+	return symbol::symbol_type(kinds[i] & ~(spelled_flag | pragma_flag));
+}
+
+
+bool token_stream::after_pragma(size_t i)
+{
+	return (kinds[i] & pragma_flag) != 0;
+}
+
+
+bool token_stream::spelled(size_t i)
+{
+	return (kinds[i] & spelled_flag) != 0;
+}
+
+
+int token_stream::name_id(size_t i)
+{
+	return payloads[i];
+}
+
+
+uint32_t token_stream::offset(size_t i)
+{
+	return offsets[i];
+}
+
+
+size_t token_stream::first_at(uint32_t offset, size_t from)
+// The end_of_program token is left out of the search; its offset is the end of the source anyway.
+{
+	return lower_bound(offsets.begin() + from, offsets.end() - 1, offset) - offsets.begin();
+}
+
+
+bool token_stream::same_token(size_t i, token_stream* other, size_t j, int64_t shift, token_pool* strings,
+		token_pool* other_strings)
+{
+	if ((kinds[i] != other->kinds[j]) or (offsets[i] + shift != other->offsets[j]))
+		return false;
+	if (kind(i) == symbol::strng)
+		return strings->string_at(payloads[i]) == other_strings->string_at(other->payloads[j]);
+	return payloads[i] == other->payloads[j];
+}
+
+
+void token_stream::splice(size_t first, size_t count, token_stream* part, token_pool* part_strings,
+		token_pool* strings, int64_t shift)
+// Errors held for the end_of_program of part belong to the token that follows it, as in append(). Any it held
+// before came from a pragma in the text lexed again, so they go, and it follows a pragma only if the end of
+// part did. Strings of the tokens replaced stay in the pool.
+{
+	size_t added = part->kinds.size() - 1;
+	vector<uint32_t> part_payloads(part->payloads.begin(), part->payloads.end() - 1);
+	for (size_t i = 0; i < added; i++)
+		if (part->kind(i) == symbol::strng)
+			part_payloads[i] = strings->add_string(part_strings->string_at(part_payloads[i]));
+
+	bool followed_pragma = after_pragma(first + count);
+	for (size_t i = first + count; i < offsets.size(); i++)
+		offsets[i] += shift;
+	kinds.erase(kinds.begin() + first, kinds.begin() + first + count);
+	kinds.insert(kinds.begin() + first, part->kinds.begin(), part->kinds.end() - 1);
+	kinds[first + added] = (kinds[first + added] & ~pragma_flag) | (part->kinds.back() & pragma_flag);
+	offsets.erase(offsets.begin() + first, offsets.begin() + first + count);
+	offsets.insert(offsets.begin() + first, part->offsets.begin(), part->offsets.end() - 1);
+	payloads.erase(payloads.begin() + first, payloads.begin() + first + count);
+	payloads.insert(payloads.begin() + first, part_payloads.begin(), part_payloads.end());
+
+	// Errors are in token order, so those of the replaced tokens are a run of their own.
+	size_t from = lower_bound(error_tokens.begin(), error_tokens.end(), first) - error_tokens.begin();
+	size_t to = lower_bound(error_tokens.begin(), error_tokens.end(), first + count + (followed_pragma ? 1 : 0))
+			- error_tokens.begin();
+	for (size_t e = to; e < errors.size(); e++)
+	{
+		errors[e].offset += shift;
+		error_tokens[e] += added - count;
+	}
+	errors.erase(errors.begin() + from, errors.begin() + to);
+	error_tokens.erase(error_tokens.begin() + from, error_tokens.begin() + to);
+	errors.insert(errors.begin() + from, part->errors.begin(), part->errors.end());
+	error_tokens.insert(error_tokens.begin() + from, part->error_tokens.begin(), part->error_tokens.end());
+	for (size_t e = from; e < from + part->errors.size(); e++)
+		error_tokens[e] += first;
+}
+
+
+token token_stream::make_token(size_t i)
+{
+	symbol::symbol_type s = kind(i);
+	token t(symbol(s), offsets[i]);
+	if (!spelled(i) or (s == symbol::identifier))		// reserved words carry no payload
+		t.set_payload(payloads[i]);
+	return t;
+}
+
+
+size_t token_stream::error_count()
+{
+	return errors.size();
+}
+
+
+size_t token_stream::error_token(size_t e)
+{
+	return error_tokens[e];
+}
+
+
+error_handler::held_error token_stream::error(size_t e)
+{
+	return errors[e];
+}
+
+
+void token_stream::append(token_stream* part, const vector<int>& name_ids, token_pool* part_strings,
+		token_pool* strings, bool last)
+// Offsets are from the start of the whole source, so tokens and errors need no moving. Errors held by part
+// go with their tokens. Any held for the end_of_program of a part that is not the last belong to whatever
+// token follows it, which is where they land.
+{
+	size_t base = kinds.size();
+	size_t count = part->kinds.size() - 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t payload = part->payloads[i];
+		if (part->spelled(i))
+			payload = name_ids[payload];
+		else if (part->kind(i) == symbol::strng)
+			payload = strings->add_string(part_strings->string_at(payload));
+		add(part->kind(i), part->spelled(i), part->offsets[i], payload);
+		if (part->after_pragma(i))
+			mark_after_pragma();
+	}
+	for (size_t e = 0; e < part->errors.size(); e++)
+	{
+		errors.push_back(part->errors[e]);
+		error_tokens.push_back(base + part->error_tokens[e]);
+	}
+	if (last)
+	{
+		add(symbol::end_of_program, false, part->offsets[count], 0);
+		if (part->after_pragma(count))
+			mark_after_pragma();
+	}
+}
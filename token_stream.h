@@ -0,0 +1,100 @@
+#ifndef TOKEN_STREAM_H_
+#define TOKEN_STREAM_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "symbol.h"
+#include "token.h"
+#include "error_handler.h"
+#include "source_buffer.h"
+#include "token_pool.h"
+
+using namespace std;
+
+class token_stream {
+// Every token of a compilation unit, lexed up front and held as parallel arrays. Token i is kinds[i],
+// offsets[i] and payloads[i]; like any token, its line and position are only worked out if asked for.
+private:
+	static const uint8_t spelled_flag = 0x80;	// Set in kinds[i] if token i was spelled with letters: an identifier,
+												// reserved word or malformed identifier. Its payload is then a name ID.
+	static const uint8_t pragma_flag = 0x40;	// Set in kinds[i] if a pragma came between token i - 1 and token i.
+	static_assert(symbol::invalid_sym < pragma_flag, "symbol_type must fit in the low bits of a kind");
+
+	vector<uint8_t> kinds;				// symbol_type of each token, plus spelled_flag and pragma_flag.
+	vector<uint32_t> offsets;			// Byte offset in the source of the first character of each token.
+	vector<uint32_t> payloads;			// Name ID, integer or real bits, or token_pool string index of each token.
+
+	vector<error_handler::held_error> errors;	// Errors the scanner found while lexing, in the order found,
+	vector<uint32_t> error_tokens;				// and the token that was being scanned when each was found.
+
+public:
+	token_stream(source_buffer* src);
+	// Creates an empty stream for the text in src, with room for the tokens it is likely to hold.
+
+	token_stream();
+	// Creates an empty stream for part of a source, to be appended to the stream for the whole of it.
+
+	void add(symbol::symbol_type s, bool spelled, size_t offset, uint32_t payload);
+	// Appends a token for symbol s starting offset bytes into the source.
+
+	void mark_after_pragma();
+	// Records that a pragma came just before the token last added.
+
+	void hold_error(const error_handler::held_error& e);
+	// Records an error found while scanning the token about to be added.
+
+	size_t size();
+	// Number of tokens, including the final end_of_program.
+
+	symbol::symbol_type kind(size_t i);
+	// Symbol of token i.
+
+	bool spelled(size_t i);
+	// True if token i was spelled with letters, so name_id(i) is meaningful.
+
+	bool after_pragma(size_t i);
+	// True if a pragma came just before token i, so lexing token i started before the token before it ended.
+
+	int name_id(size_t i);
+	// Name table ID of the spelling of token i.
+
+	uint32_t offset(size_t i);
+	// Byte offset in the source of token i.
+
+	size_t first_at(uint32_t offset, size_t from);
+	// Index of the first token from token from on that starts at or after offset, or of the end_of_program
+	// token if there is none. Offsets rise from token from on.
+
+	void append(token_stream* part, const vector<int>& name_ids, token_pool* part_strings, token_pool* strings,
+			bool last);
+	// Appends the tokens of part, which was lexed with its own name table and token pool. Name IDs are
+	// translated by name_ids and strings are copied from part_strings to strings.
+	// The end_of_program token of part is only appended if it is the last part of the source.
+
+	bool same_token(size_t i, token_stream* other, size_t j, int64_t shift, token_pool* strings,
+			token_pool* other_strings);
+	// True if token i, moved by shift bytes, is the same as token j of other: the same symbol and value at the
+	// same place. String payloads are held in strings and other_strings respectively.
+
+	void splice(size_t first, size_t count, token_stream* part, token_pool* part_strings, token_pool* strings,
+			int64_t shift);
+	// Replaces the count tokens from token first on, and the errors held for them, with the tokens of part
+	// other than its end_of_program, and its errors. Part was lexed in the same name table as this stream,
+	// with its own token pool. Every later token and error is moved shift bytes further into the source.
+
+	token make_token(size_t i);
+	// Token i as a token object.
+
+	size_t error_count();
+	// Number of errors held.
+
+	size_t error_token(size_t e);
+	// Token that held error e belongs to.
+
+	error_handler::held_error error(size_t e);
+	// Held error e.
+};
+
+#endif /* TOKEN_STREAM_H_ */